@@ -0,0 +1,108 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace VPP {
+namespace Bench {
+
+// Runs `func` until at least `minSeconds` have passed (and at least twice)
+// and returns the fastest single run in nanoseconds.
+template<typename Func>
+double Measure(Func &&func, double minSeconds = 0.25) {
+    using Clock = std::chrono::steady_clock;
+    double best = 0.0;
+    double total = 0.0;
+    for(int runs = 0; runs < 2 || total < minSeconds * 1e9; runs++) {
+        auto start = Clock::now();
+        func();
+        double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        best = runs == 0 || elapsed < best ? elapsed : best;
+        total += elapsed;
+    }
+    return best;
+}
+
+// Same, for operations that consume their input: `setup` runs untimed
+// before every run of `func`.
+template<typename Setup, typename Func>
+double MeasureWithSetup(Setup &&setup, Func &&func, double minSeconds = 0.25) {
+    using Clock = std::chrono::steady_clock;
+    double best = 0.0;
+    double total = 0.0;
+    for(int runs = 0; runs < 2 || total < minSeconds * 1e9; runs++) {
+        setup();
+        auto start = Clock::now();
+        func();
+        double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        best = runs == 0 || elapsed < best ? elapsed : best;
+        total += elapsed;
+    }
+    return best;
+}
+
+struct Result {
+    std::string Name;
+    size_t Items;
+    double Nanoseconds;
+};
+
+// Everything Report() printed so far, for WriteJson().
+inline std::vector<Result> &GetResults() {
+    static std::vector<Result> s_Results;
+    return s_Results;
+}
+
+inline void Report(const std::string &name, size_t items, double nanoseconds) {
+    printf("%-40s %10zu items %12.3f ms %10.3f ns/item\n", name.c_str(), items, nanoseconds * 1e-6, nanoseconds / items);
+    GetResults().push_back({name, items, nanoseconds});
+}
+
+// Writes the reported results in the layout of Google Benchmark's JSON
+// output (one entry per Report(), times in nanoseconds), plus `context`
+// entries as strings.
+inline bool WriteJson(const std::string &path, const std::vector<std::pair<std::string, std::string>> &context) {
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if(!file)
+        return false;
+
+    auto writeString = [file](const std::string &text) {
+        std::fputc('"', file);
+        for(char c: text) {
+            if(c == '"' || c == '\\')
+                std::fprintf(file, "\\%c", c);
+            else if(static_cast<unsigned char>(c) < 0x20)
+                std::fprintf(file, "\\u%04x", static_cast<unsigned>(c));
+            else
+                std::fputc(c, file);
+        }
+        std::fputc('"', file);
+    };
+
+    std::fputs("{\n  \"context\": {", file);
+    for(size_t i = 0; i < context.size(); i++) {
+        std::fputs(i == 0 ? "\n    " : ",\n    ", file);
+        writeString(context[i].first);
+        std::fputs(": ", file);
+        writeString(context[i].second);
+    }
+    std::fputs("\n  },\n  \"benchmarks\": [", file);
+
+    const std::vector<Result> &results = GetResults();
+    for(size_t i = 0; i < results.size(); i++) {
+        const Result &result = results[i];
+        std::fputs(i == 0 ? "\n    {\"name\": " : ",\n    {\"name\": ", file);
+        writeString(result.Name + "/" + std::to_string(result.Items));
+        std::fprintf(file, ", \"items\": %zu, \"real_time\": %.1f, \"time_unit\": \"ns\", \"ns_per_item\": %.4f, \"items_per_second\": %.1f}",
+                     result.Items, result.Nanoseconds, result.Nanoseconds / result.Items, result.Items / (result.Nanoseconds * 1e-9));
+    }
+    std::fputs("\n  ]\n}\n", file);
+
+    bool written = !std::ferror(file);
+    return std::fclose(file) == 0 && written;
+}
+
+} // namespace Bench
+} // namespace VPP
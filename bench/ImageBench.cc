@@ -0,0 +1,77 @@
+#include <random>
+#include <vector>
+#include "Bench.h"
+#include "ImageOps.h"
+#include "ThreadPool.h"
+
+namespace VPP {
+namespace Bench {
+
+namespace {
+
+// Measures `func` with the scalar kernels, the selected ones and the
+// selected ones spread over `pool`; func(pool) runs on the calling thread
+// when given no pool.
+template<typename Func>
+void CompareImageKernels(const std::string &name, size_t items, ThreadPool &pool, Func func) {
+    SetImageKernelsScalar(true);
+    double scalar = Measure([&] { func(nullptr); });
+    SetImageKernelsScalar(false);
+    double simd = Measure([&] { func(nullptr); });
+    double threaded = Measure([&] { func(&pool); });
+
+    Report(name + " scalar", items, scalar);
+    Report(name + " " + GetImageKernelName(), items, simd);
+    Report(name + " " + GetImageKernelName() + " threaded", items, threaded);
+    printf("%-40s %10zu items %12.2fx %8.2fx threaded\n", "speedup", items, scalar / simd, scalar / threaded);
+}
+
+} // namespace
+
+void RunImageBenchmarks() {
+    printf("image kernels: %s\n", GetImageKernelName());
+
+    ThreadPool &pool = ThreadPool::GetDefault();
+    const uint32_t size = 4096;
+    const size_t pixels = size_t(size) * size;
+
+    std::mt19937 engine(42);
+    std::vector<uint8_t> chain(GetMipChainSize(size, size, 4));
+    for(size_t i = 0; i < pixels * 4; i++)
+        chain[i] = uint8_t(engine());
+    std::vector<uint8_t> converted(pixels * 4);
+    std::vector<uint16_t> packed(pixels);
+
+    for(DownsampleOptions options: {DownsampleOptions{MipFilter::Box, false}, DownsampleOptions{MipFilter::Box, true},
+                                    DownsampleOptions{MipFilter::Kaiser, false}, DownsampleOptions{MipFilter::Kaiser, true}}) {
+        std::string name = std::string("mip chain ") + (options.Filter == MipFilter::Box ? "box" : "kaiser") + (options.SRGB ? " srgb" : "");
+        CompareImageKernels(name, pixels, pool, [&](ThreadPool *threads) {
+            if(threads)
+                GenerateMipChainRGBA8(*threads, chain.data(), size, size, options);
+            else
+                GenerateMipChainRGBA8(chain.data(), size, size, options);
+        });
+    }
+
+    CompareImageKernels("swizzle bgra", pixels, pool, [&](ThreadPool *threads) {
+        if(threads)
+            SwizzleRGBA8(*threads, chain.data(), pixels, {2, 1, 0, 3}, converted.data());
+        else
+            SwizzleRGBA8(chain.data(), pixels, {2, 1, 0, 3}, converted.data());
+    });
+    CompareImageKernels("premultiply alpha", pixels, pool, [&](ThreadPool *threads) {
+        if(threads)
+            PremultiplyAlphaRGBA8(*threads, chain.data(), pixels, converted.data());
+        else
+            PremultiplyAlphaRGBA8(chain.data(), pixels, converted.data());
+    });
+    CompareImageKernels("rgb565", pixels, pool, [&](ThreadPool *threads) {
+        if(threads)
+            ConvertRGBA8ToRGB565(*threads, chain.data(), pixels, packed.data());
+        else
+            ConvertRGBA8ToRGB565(chain.data(), pixels, packed.data());
+    });
+}
+
+} // namespace Bench
+} // namespace VPP
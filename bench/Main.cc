@@ -0,0 +1,62 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Bench.h"
+#include "ImageOps.h"
+#include "TransformBatch.h"
+
+namespace VPP {
+namespace Bench {
+
+void RunImageBenchmarks();
+void RunSceneBenchmarks();
+void RunTransformBenchmarks();
+
+} // namespace Bench
+} // namespace VPP
+
+// Usage: vpp_bench [--json <path>] [transform] [image] [scene]
+// Runs every group when none is named.
+int main(int argc, char **argv) {
+    std::string jsonPath;
+    std::vector<std::string> groups;
+    for(int i = 1; i < argc; i++) {
+        if(std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            jsonPath = argv[++i];
+        else
+            groups.push_back(argv[i]);
+    }
+
+    auto selected = [&groups](const char *group) {
+        if(groups.empty())
+            return true;
+        for(const std::string &name: groups) {
+            if(name == group)
+                return true;
+        }
+        return false;
+    };
+
+    if(selected("transform"))
+        VPP::Bench::RunTransformBenchmarks();
+    if(selected("image"))
+        VPP::Bench::RunImageBenchmarks();
+    if(selected("scene"))
+        VPP::Bench::RunSceneBenchmarks();
+
+    if(!jsonPath.empty()) {
+        std::vector<std::pair<std::string, std::string>> context = {
+            {"executable", argv[0]},
+            {"num_cpus", std::to_string(std::thread::hardware_concurrency())},
+            {"transform_kernel", VPP::GetTransformKernelName()},
+            {"image_kernel", VPP::GetImageKernelName()},
+        };
+        if(!VPP::Bench::WriteJson(jsonPath, context)) {
+            std::fprintf(stderr, "failed to write %s\n", jsonPath.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+#include "Bench.h"
+#include "GameObject.h"
+#include "Scene.h"
+
+namespace VPP {
+namespace Bench {
+
+namespace {
+
+// Keeps the optimizer from dropping work whose result is otherwise unused.
+volatile uint64_t s_Sink;
+
+std::vector<std::string> MakeNames(size_t count) {
+    std::vector<std::string> names(count);
+    for(size_t i = 0; i < count; i++)
+        names[i] = "Entity " + std::to_string(i);
+    return names;
+}
+
+void RunSceneBenchmarks(size_t count) {
+    std::mt19937 engine(42);
+    std::vector<std::string> names = MakeNames(count);
+
+    std::unique_ptr<Scene> scene;
+    double create = MeasureWithSetup([&] { scene = std::make_unique<Scene>(); }, [&] {
+        for(size_t i = 0; i < count; i++)
+            scene->CreateGameObject(names[i]);
+    });
+    Report("Scene::CreateGameObject", count, create);
+
+    std::vector<GameObject> objects;
+    double destroy = MeasureWithSetup([&] {
+        scene = std::make_unique<Scene>();
+        objects.clear();
+        for(size_t i = 0; i < count; i++)
+            objects.push_back(scene->CreateGameObject(names[i]));
+        std::shuffle(objects.begin(), objects.end(), engine);
+    }, [&] {
+        for(GameObject object: objects)
+            scene->DestroyGameObject(object);
+    });
+    Report("Scene::DestroyGameObject", count, destroy);
+
+    double createArena = MeasureWithSetup([&] { scene = std::make_unique<Scene>(SceneMemory::Arena); }, [&] {
+        for(size_t i = 0; i < count; i++)
+            scene->CreateGameObject(names[i]);
+    });
+    Report("Scene::CreateGameObject (arena)", count, createArena);
+
+    // Tearing down a whole scene: one free per pool block on the heap, a
+    // few large ones for an arena.
+    for(SceneMemory memory: {SceneMemory::Heap, SceneMemory::Arena}) {
+        double teardown = MeasureWithSetup([&] {
+            scene = std::make_unique<Scene>(memory);
+            scene->CreateGameObjects(count);
+        }, [&] { scene.reset(); });
+        Report(memory == SceneMemory::Arena ? "Scene::~Scene (arena)" : "Scene::~Scene", count, teardown);
+    }
+
+    // Lookups run against one populated scene, in random order so the
+    // cost of cache misses shows.
+    scene = std::make_unique<Scene>();
+    std::vector<UUID> uuids;
+    for(size_t i = 0; i < count; i++)
+        uuids.push_back(scene->CreateGameObject(names[i]).GetUUID());
+    std::shuffle(uuids.begin(), uuids.end(), engine);
+    std::shuffle(names.begin(), names.end(), engine);
+
+    double byUUID = Measure([&] {
+        uint64_t found = 0;
+        for(UUID uuid: uuids)
+            found += scene->GetGameObjectByUUID(uuid) ? 1 : 0;
+        s_Sink = found;
+    });
+    Report("Scene::GetGameObjectByUUID", count, byUUID);
+
+    double byName = Measure([&] {
+        uint64_t found = 0;
+        for(const std::string &name: names)
+            found += scene->FindGameObjectByName(name) ? 1 : 0;
+        s_Sink = found;
+    });
+    Report("Scene::FindGameObjectByName", count, byName);
+
+    // Component access on random objects: the registry looks the pool up
+    // by type on every call, GameObject goes through the scene's pool
+    // table, and an accessor holds the pool itself. The registry is a
+    // stand-alone one with the scene's pools, read through a volatile
+    // pointer (as a GameObject reads its scene) so the pool lookup cannot
+    // be hoisted out of the loop.
+    std::vector<GameObject> lookupObjects;
+    Registry registry;
+    Registry *volatile registryPointer = &registry;
+    for(auto [entity, id, tag, transform]: scene->GetAllGameObjectsWith<IDComponent, TagComponent, Transform>().each()) {
+        lookupObjects.push_back({entity, scene.get()});
+        entt::entity copy = registry.create();
+        registry.emplace<IDComponent>(copy, id);
+        registry.emplace<TagComponent>(copy, tag);
+        registry.emplace<Transform>(copy, transform);
+        registry.emplace<WorldTransform>(copy);
+    }
+    std::shuffle(lookupObjects.begin(), lookupObjects.end(), engine);
+
+    double registryGet = Measure([&] {
+        float sum = 0.0f;
+        for(GameObject object: lookupObjects)
+            sum += registryPointer->get<Transform>(object).Scale.x;
+        s_Sink = static_cast<uint64_t>(sum);
+    });
+    Report("Registry::get<Transform>", count, registryGet);
+
+    double getComponent = Measure([&] {
+        float sum = 0.0f;
+        for(GameObject object: lookupObjects)
+            sum += object.GetComponent<Transform>().Scale.x;
+        s_Sink = static_cast<uint64_t>(sum);
+    });
+    Report("GameObject::GetComponent<Transform>", count, getComponent);
+
+    ComponentAccessor<Transform> transforms = scene->GetComponentAccessor<Transform>();
+    double accessorGet = Measure([&] {
+        float sum = 0.0f;
+        for(GameObject object: lookupObjects)
+            sum += transforms.Get(object).Scale.x;
+        s_Sink = static_cast<uint64_t>(sum);
+    });
+    Report("ComponentAccessor<Transform>::Get", count, accessorGet);
+
+    double registryHas = Measure([&] {
+        uint64_t found = 0;
+        for(GameObject object: lookupObjects)
+            found += registryPointer->all_of<WorldTransform>(object) ? 1 : 0;
+        s_Sink = found;
+    });
+    Report("Registry::all_of<WorldTransform>", count, registryHas);
+
+    double hasComponent = Measure([&] {
+        uint64_t found = 0;
+        for(GameObject object: lookupObjects)
+            found += object.HasComponent<WorldTransform>() ? 1 : 0;
+        s_Sink = found;
+    });
+    Report("GameObject::HasComponent<WorldTransform>", count, hasComponent);
+
+    std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+    for(auto [entity, transform]: scene->GetAllGameObjectsWith<Transform>().each()) {
+        transform.Translation = {distribution(engine), distribution(engine), distribution(engine)};
+        transform.Rotation = {distribution(engine), distribution(engine), distribution(engine)};
+    }
+
+    double getTransform = Measure([&] {
+        float sum = 0.0f;
+        for(auto [entity, transform]: scene->GetAllGameObjectsWith<Transform>().each())
+            sum += transform.GetTransform()[3][0];
+        s_Sink = static_cast<uint64_t>(sum);
+    });
+    Report("Transform::GetTransform", count, getTransform);
+
+    double viewOne = Measure([&] {
+        float sum = 0.0f;
+        for(auto [entity, transform]: scene->GetAllGameObjectsWith<Transform>().each())
+            sum += transform.Translation.x;
+        s_Sink = static_cast<uint64_t>(sum);
+    });
+    Report("view<Transform>", count, viewOne);
+
+    double viewTwo = Measure([&] {
+        uint64_t sum = 0;
+        for(auto [entity, id, transform]: scene->GetAllGameObjectsWith<IDComponent, Transform>().each())
+            sum += static_cast<uint64_t>(id.ID) + static_cast<uint64_t>(transform.Scale.x);
+        s_Sink = sum;
+    });
+    Report("view<IDComponent, Transform>", count, viewTwo);
+}
+
+// Building an 8-ary tree with SetParent, then destroying every other node,
+// as in a level load and a mass despawn. Each is followed by the
+// UpdateWorldTransforms() that reorders the Hierarchy pool and propagates.
+void RunHierarchyBenchmarks(size_t count) {
+    std::unique_ptr<Scene> scene;
+    std::vector<GameObject> objects;
+    auto createObjects = [&] {
+        scene = std::make_unique<Scene>();
+        objects = scene->CreateGameObjects(count);
+    };
+    auto buildTree = [&] {
+        for(size_t i = 1; i < count; i++)
+            objects[i].SetParent(objects[(i - 1) / 8]);
+    };
+
+    double build = MeasureWithSetup(createObjects, buildTree);
+    Report("Scene::SetParent (8-ary tree)", count, build);
+
+    double update = MeasureWithSetup([&] {
+        createObjects();
+        buildTree();
+    }, [&] { scene->UpdateWorldTransforms(); });
+    Report("UpdateWorldTransforms (new 8-ary tree)", count, update);
+
+    double destroy = MeasureWithSetup([&] {
+        createObjects();
+        buildTree();
+        scene->UpdateWorldTransforms();
+    }, [&] {
+        for(size_t i = 0; i < count; i += 2)
+            scene->DestroyGameObject(objects[i]);
+        scene->UpdateWorldTransforms();
+    });
+    Report("DestroyGameObject half of tree + update", count / 2, destroy);
+}
+
+// Proximity queries against objects scattered at a fixed density, about
+// ten within each query radius: a scan over every Transform, then each
+// index kind on its own scene.
+void RunSpatialBenchmarks(size_t count) {
+    constexpr size_t QueryCount = 1024;
+    constexpr float Radius = 8.0f;
+    std::mt19937 engine(7);
+    float extent = std::cbrt(float(count) * 4.0f * 3.1416f * Radius * Radius * Radius / 3.0f / 10.0f) * 0.5f;
+    std::uniform_real_distribution<float> position(-extent, extent);
+
+    std::vector<glm::vec3> positions(count);
+    for(glm::vec3 &each: positions)
+        each = {position(engine), position(engine), position(engine)};
+    std::vector<SpatialSphere> queries(QueryCount);
+    for(SpatialSphere &query: queries)
+        query = {{position(engine), position(engine), position(engine)}, Radius};
+
+    auto populate = [&](Scene &scene) {
+        std::vector<GameObject> objects = scene.CreateGameObjects(count);
+        for(size_t i = 0; i < count; i++)
+            objects[i].GetComponent<Transform>().Translation = positions[i];
+        scene.UpdateWorldTransforms();
+    };
+
+    // A tenth of the objects nudged per tick, as after a frame of movement;
+    // an enabled index is refreshed inside UpdateWorldTransforms.
+    std::uniform_real_distribution<float> nudge(-0.5f, 0.5f);
+    auto measureUpdate = [&](Scene &scene, const std::string &name) {
+        std::vector<GameObject> moving;
+        for(auto [entity, transform]: scene.GetAllGameObjectsWith<Transform>().each()) {
+            if(moving.size() < count / 10)
+                moving.push_back({entity, &scene});
+        }
+        double update = MeasureWithSetup([&] {
+            for(GameObject object: moving)
+                object.PatchComponent<Transform>([&](Transform &transform) {
+                    transform.Translation += glm::vec3(nudge(engine), nudge(engine), nudge(engine));
+                });
+        }, [&] { scene.UpdateWorldTransforms(); });
+        Report(name, moving.size(), update);
+    };
+
+    Scene plain;
+    populate(plain);
+    measureUpdate(plain, "UpdateWorldTransforms (" + std::to_string(count) + ")");
+    std::vector<entt::entity> found;
+    double scan = Measure([&] {
+        uint64_t total = 0;
+        for(const SpatialSphere &query: queries) {
+            found.clear();
+            for(auto [entity, transform]: plain.GetAllGameObjectsWith<Transform>().each()) {
+                glm::vec3 delta = transform.Translation - query.Center;
+                if(glm::dot(delta, delta) <= query.Radius * query.Radius)
+                    found.push_back(entity);
+            }
+            total += found.size();
+        }
+        s_Sink = total;
+    });
+    Report("Transform scan radius query (" + std::to_string(count) + ")", QueryCount, scan);
+
+    SpatialIndexSettings octreeSettings;
+    octreeSettings.Type = SpatialIndexType::LooseOctree;
+    octreeSettings.HalfExtent = extent;
+    SpatialIndexSettings gridSettings;
+    gridSettings.CellSize = Radius * 2.0f;
+    for(const SpatialIndexSettings &settings: {gridSettings, octreeSettings}) {
+        std::string kind = settings.Type == SpatialIndexType::Grid ? "Grid" : "LooseOctree";
+        std::string suffix = " (" + std::to_string(count) + ")";
+
+        Scene scene;
+        populate(scene);
+        double enable = Measure([&] { scene.EnableSpatialIndex(settings); });
+        Report(kind + " build" + suffix, count, enable);
+        const SpatialIndex &index = *scene.GetSpatialIndex();
+
+        double radius = Measure([&] {
+            uint64_t total = 0;
+            for(const SpatialSphere &query: queries) {
+                index.QueryRadius(query.Center, query.Radius, found);
+                total += found.size();
+            }
+            s_Sink = total;
+        });
+        Report(kind + "::QueryRadius" + suffix, QueryCount, radius);
+
+        double nearest = Measure([&] {
+            uint64_t total = 0;
+            for(const SpatialSphere &query: queries) {
+                index.QueryNearest(query.Center, 8, found);
+                total += found.size();
+            }
+            s_Sink = total;
+        });
+        Report(kind + "::QueryNearest k=8" + suffix, QueryCount, nearest);
+
+        std::vector<std::vector<entt::entity>> results(QueryCount);
+        double batch = Measure([&] {
+            index.QueryRadiusBatch(scene.GetThreadPool(), queries.data(), QueryCount, results.data());
+            s_Sink = results[0].size();
+        });
+        Report(kind + "::QueryRadiusBatch" + suffix, QueryCount, batch);
+
+        measureUpdate(scene, kind + " UpdateWorldTransforms" + suffix);
+    }
+}
+
+} // namespace
+
+void RunSceneBenchmarks() {
+    for(size_t count: {size_t(1000), size_t(100000), size_t(1000000)})
+        RunSceneBenchmarks(count);
+    for(size_t count: {size_t(10000), size_t(100000)})
+        RunHierarchyBenchmarks(count);
+    for(size_t count: {size_t(1000), size_t(100000), size_t(1000000)})
+        RunSpatialBenchmarks(count);
+}
+
+} // namespace Bench
+} // namespace VPP
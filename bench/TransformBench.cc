@@ -0,0 +1,38 @@
+#include <random>
+#include <vector>
+#include "Bench.h"
+#include "GameObject.h"
+#include "TransformBatch.h"
+
+namespace VPP {
+namespace Bench {
+
+void RunTransformBenchmarks() {
+    printf("transform kernel: %s\n", GetTransformKernelName());
+
+    for(size_t count: {size_t(10000), size_t(100000), size_t(1000000)}) {
+        std::mt19937 engine(42);
+        std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+        std::vector<Transform> transforms(count);
+        for(auto &transform: transforms) {
+            transform.Translation = {distribution(engine), distribution(engine), distribution(engine)};
+            transform.Rotation = {distribution(engine), distribution(engine), distribution(engine)};
+        }
+        std::vector<glm::mat4> matrices(count);
+
+        double perEntity = Measure([&] {
+            for(size_t i = 0; i < count; i++)
+                matrices[i] = transforms[i].GetTransform();
+        });
+        double batched = Measure([&] {
+            ComputeTransformMatrices(transforms.data(), matrices.data(), count);
+        });
+
+        Report("Transform::GetTransform", count, perEntity);
+        Report("ComputeTransformMatrices", count, batched);
+        printf("%-40s %10zu items %12.2fx\n", "speedup", count, perEntity / batched);
+    }
+}
+
+} // namespace Bench
+} // namespace VPP
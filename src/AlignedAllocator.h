@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace VPP {
+
+// Standard allocator whose blocks start on an `Alignment` byte boundary, so
+// containers of plain data can be streamed with aligned SIMD loads. Blocks
+// come from `resource`, the global heap unless one is given.
+template<typename T, size_t Alignment = 64>
+class AlignedAllocator {
+public:
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    AlignedAllocator(std::pmr::memory_resource *resource) noexcept
+        : m_Resource(resource) {}
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &other) noexcept
+        : m_Resource(other.GetResource()) {}
+
+    T *allocate(size_t count) {
+        return static_cast<T *>(m_Resource->allocate(count * sizeof(T), Alignment));
+    }
+
+    void deallocate(T *pointer, size_t count) noexcept {
+        m_Resource->deallocate(pointer, count * sizeof(T), Alignment);
+    }
+
+    std::pmr::memory_resource *GetResource() const noexcept {
+        return m_Resource;
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &other) const noexcept {
+        return *m_Resource == *other.GetResource();
+    }
+    template<typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &other) const noexcept {
+        return !(*this == other);
+    }
+
+private:
+    std::pmr::memory_resource *m_Resource = std::pmr::new_delete_resource();
+};
+
+} // namespace VPP
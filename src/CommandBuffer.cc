@@ -0,0 +1,29 @@
+#include "CommandBuffer.h"
+
+namespace VPP {
+
+CommandBuffer::PendingObject CommandBuffer::CreateWithUUID(UUID uuid, const std::string &name) {
+    m_CreatedUUIDs.push_back(uuid);
+    m_CreatedNames.push_back(name);
+    return {static_cast<uint32_t>(m_CreatedUUIDs.size() - 1)};
+}
+
+bool CommandBuffer::IsEmpty() const {
+    if(!m_CreatedUUIDs.empty() || !m_Destroyed.empty())
+        return false;
+    for(const auto &list: m_Lists) {
+        if(!list->IsEmpty())
+            return false;
+    }
+    return true;
+}
+
+void CommandBuffer::Clear() {
+    m_CreatedUUIDs.clear();
+    m_CreatedNames.clear();
+    m_Destroyed.clear();
+    for(const auto &list: m_Lists)
+        list->Clear();
+}
+
+} // namespace VPP
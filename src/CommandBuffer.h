@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <entt/entt.hpp>
+#include "FlatHashMap.h"
+#include "Registry.h"
+#include "UUID.h"
+
+namespace VPP {
+
+// Structural changes recorded while the registry must not change: from a
+// system, while iterating a view, or from a worker thread. Each thread
+// records into its own buffer (Scene::GetCommandBuffer()), so recording
+// takes no lock; Scene::PlayCommands() applies every buffer at the next
+// sync point.
+//
+// Commands target entities by handle. One destroyed or recycled by the
+// time the commands are played is skipped.
+class CommandBuffer {
+public:
+    // An object Create() makes at playback. Later commands of the same
+    // buffer may target it.
+    struct PendingObject {
+        uint32_t Index;
+    };
+
+    CommandBuffer() = default;
+    CommandBuffer(const CommandBuffer &) = delete;
+    CommandBuffer &operator=(const CommandBuffer &) = delete;
+
+    // Same as Scene::CreateGameObject(); the UUID is drawn right away.
+    PendingObject Create(const std::string &name = std::string()) {
+        return CreateWithUUID(GenerateUUID(), name);
+    }
+    PendingObject CreateWithUUID(UUID uuid, const std::string &name = std::string());
+
+    void Destroy(entt::entity entity) {
+        m_Destroyed.push_back(entity);
+    }
+
+    // Adds a T built from `args`, or replaces the object's T if it has one
+    // by then.
+    template<typename T, typename... Args>
+    void Emplace(entt::entity entity, Args &&...args) {
+        GetList<T>().Emplace({entity, 0}, std::forward<Args>(args)...);
+    }
+    template<typename T, typename... Args>
+    void Emplace(PendingObject object, Args &&...args) {
+        GetList<T>().Emplace({entt::null, object.Index + 1}, std::forward<Args>(args)...);
+    }
+
+    template<typename T>
+    void Remove(entt::entity entity) {
+        GetList<T>().Remove({entity, 0});
+    }
+    template<typename T>
+    void Remove(PendingObject object) {
+        GetList<T>().Remove({entt::null, object.Index + 1});
+    }
+
+    bool IsEmpty() const;
+    // Drops the recorded commands; the memory is kept for the next frame.
+    void Clear();
+
+private:
+    // An existing entity, or (Pending != 0) the object Create() number
+    // Pending - 1 will make.
+    struct Target {
+        entt::entity Entity;
+        uint32_t Pending;
+    };
+
+    // Commands on one component type, in recording order.
+    class ListBase {
+    public:
+        explicit ListBase(entt::id_type type)
+            : m_Type(type) {}
+        virtual ~ListBase() = default;
+
+        entt::id_type GetType() const {
+            return m_Type;
+        }
+
+        virtual bool IsEmpty() const = 0;
+        virtual void Clear() = 0;
+        // `created` holds the entities of this buffer's Create() commands.
+        virtual void Play(Registry &registry, const entt::entity *created) = 0;
+
+    private:
+        entt::id_type m_Type;
+    };
+
+    template<typename T>
+    class List: public ListBase {
+    public:
+        List()
+            : ListBase(entt::type_id<T>().hash()) {}
+
+        template<typename... Args>
+        void Emplace(Target target, Args &&...args) {
+            m_Commands.push_back({target, false});
+            if constexpr(!std::is_empty_v<T>) {
+                if constexpr(std::is_aggregate_v<T>)
+                    m_Values.push_back(T{std::forward<Args>(args)...});
+                else
+                    m_Values.emplace_back(std::forward<Args>(args)...);
+            }
+        }
+
+        void Remove(Target target) {
+            m_Commands.push_back({target, true});
+        }
+
+        bool IsEmpty() const override {
+            return m_Commands.empty();
+        }
+
+        void Clear() override {
+            m_Commands.clear();
+            m_Values.clear();
+        }
+
+        void Play(Registry &registry, const entt::entity *created) override {
+            auto &pool = registry.storage<T>();
+            pool.reserve(pool.size() + m_Values.size());
+
+            size_t next = 0;
+            for(const Command &command: m_Commands) {
+                entt::entity entity = command.Object.Pending ? created[command.Object.Pending - 1] : command.Object.Entity;
+                if(command.Remove) {
+                    if(registry.valid(entity))
+                        pool.remove(entity);
+                    continue;
+                }
+
+                if constexpr(std::is_empty_v<T>) {
+                    if(registry.valid(entity) && !pool.contains(entity))
+                        pool.emplace(entity);
+                } else {
+                    T &value = m_Values[next++];
+                    if(!registry.valid(entity))
+                        continue;
+                    if(pool.contains(entity))
+                        pool.patch(entity, [&value](auto &...current) { ((current = std::move(value)), ...); });
+                    else
+                        pool.emplace(entity, std::move(value));
+                }
+            }
+        }
+
+    private:
+        struct Command {
+            Target Object;
+            bool Remove;
+        };
+
+        std::vector<Command> m_Commands;
+        // One per emplace, in command order.
+        std::vector<T> m_Values;
+    };
+
+    template<typename T>
+    List<T> &GetList() {
+        size_t &index = m_ListIndex[entt::type_id<T>().hash()];
+        if(index == 0) {
+            m_Lists.push_back(std::make_unique<List<T>>());
+            index = m_Lists.size();
+        }
+        return static_cast<List<T> &>(*m_Lists[index - 1]);
+    }
+
+private:
+    std::vector<UUID> m_CreatedUUIDs;
+    std::vector<std::string> m_CreatedNames;
+    std::vector<entt::entity> m_Destroyed;
+
+    // Component type -> index into m_Lists + 1. Lists stay allocated once
+    // a type has been used, so steady-state recording does not allocate.
+    FlatHashMap<entt::id_type, size_t> m_ListIndex;
+    std::vector<std::unique_ptr<ListBase>> m_Lists;
+
+    friend class Scene;
+};
+
+} // namespace VPP
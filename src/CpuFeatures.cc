@@ -0,0 +1,46 @@
+#include "CpuFeatures.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace VPP {
+
+namespace {
+
+bool DetectAVX2() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+    if(info[0] < 7)
+        return false;
+
+    __cpuid(info, 1);
+    bool hasFMA = (info[2] & (1 << 12)) != 0;
+    bool hasOSXSAVE = (info[2] & (1 << 27)) != 0;
+    bool hasAVX = (info[2] & (1 << 28)) != 0;
+    if(!hasFMA || !hasOSXSAVE || !hasAVX)
+        return false;
+
+    // The OS must save the YMM registers on context switches.
+    if((_xgetbv(0) & 0x6) != 0x6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+bool CpuSupportsAVX2() {
+    static const bool s_Supported = DetectAVX2();
+    return s_Supported;
+}
+
+} // namespace VPP
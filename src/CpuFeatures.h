@@ -0,0 +1,9 @@
+#pragma once
+
+namespace VPP {
+
+// Whether the CPU and OS support AVX2 and FMA, for picking the kernels
+// built in the *AVX2.cc translation units. Checked once, then cached.
+bool CpuSupportsAVX2();
+
+} // namespace VPP
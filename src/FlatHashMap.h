@@ -0,0 +1,424 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VPP_FLAT_HASH_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace VPP {
+
+// Hash for integer-like keys (UUIDs, entities, enums). Ids are mostly
+// sequential, so the bits are mixed properly: the map takes its probe
+// position from the high bits and its tag from the low ones.
+template<typename K>
+struct FlatHash {
+    static_assert(std::is_integral_v<K> || std::is_enum_v<K>, "FlatHash needs an integer or enum key");
+
+    uint64_t operator()(K key) const {
+        uint64_t x = static_cast<uint64_t>(key);
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ull;
+        x ^= x >> 33;
+        return x;
+    }
+};
+
+// Open-addressing hash map in the style of Swiss tables: one control byte
+// per slot holds 7 bits of the key's hash (or marks the slot empty or
+// deleted), and lookups compare a whole group of 16 control bytes at once
+// (one SSE2 compare) before touching any key. Keys and values live inline
+// in a single allocation, so a lookup costs one or two cache misses where
+// std::unordered_map chases a node pointer.
+//
+// Keys must be trivially copyable (ids, handles); values may be anything
+// movable. Pointers returned by Find() and operator[] stay valid until the
+// next insertion that grows the table, or until the key is erased.
+template<typename K, typename V, typename Hash = FlatHash<K>>
+class FlatHashMap {
+public:
+    static_assert(std::is_trivially_copyable_v<K>, "FlatHashMap keys must be trivially copyable");
+
+    static constexpr size_t GroupWidth = 16;
+
+    FlatHashMap() = default;
+    ~FlatHashMap() {
+        Destroy();
+    }
+
+    FlatHashMap(const FlatHashMap &other) {
+        *this = other;
+    }
+    FlatHashMap &operator=(const FlatHashMap &other) {
+        if(this == &other)
+            return *this;
+        Clear();
+        Reserve(other.m_Size);
+        other.ForEach([this](const K &key, const V &value) {
+            InsertNew(key, m_Hash(key), value);
+        });
+        return *this;
+    }
+
+    FlatHashMap(FlatHashMap &&other) noexcept {
+        Swap(other);
+    }
+    FlatHashMap &operator=(FlatHashMap &&other) noexcept {
+        if(this != &other) {
+            Destroy();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    size_t Size() const {
+        return m_Size;
+    }
+    bool IsEmpty() const {
+        return m_Size == 0;
+    }
+    size_t Capacity() const {
+        return m_Capacity;
+    }
+
+    // Makes room for `count` entries without growing again.
+    void Reserve(size_t count) {
+        if(count + m_Deleted > MaxLoad(m_Capacity))
+            Rehash(CapacityFor(count));
+    }
+
+    void Clear() {
+        if(m_Size == 0 && m_Deleted == 0)
+            return;
+        for(size_t i = 0; i < m_Capacity; i++) {
+            if(IsFull(m_Control[i]))
+                m_Slots[i].~Slot();
+        }
+        std::memset(m_Control, Empty, m_Capacity);
+        m_Size = 0;
+        m_Deleted = 0;
+    }
+
+    V *Find(const K &key) {
+        size_t index = FindIndex(key, m_Hash(key));
+        return index == NotFound ? nullptr : &m_Slots[index].Value;
+    }
+    const V *Find(const K &key) const {
+        size_t index = FindIndex(key, m_Hash(key));
+        return index == NotFound ? nullptr : &m_Slots[index].Value;
+    }
+    bool Contains(const K &key) const {
+        return FindIndex(key, m_Hash(key)) != NotFound;
+    }
+
+    // Default-constructs the value if the key is new.
+    V &operator[](const K &key) {
+        uint64_t hash = m_Hash(key);
+        size_t index = FindIndex(key, hash);
+        if(index != NotFound)
+            return m_Slots[index].Value;
+        Reserve(m_Size + 1);
+        return m_Slots[InsertNew(key, hash, V())].Value;
+    }
+
+    // Returns true if the key was new.
+    template<typename T>
+    bool InsertOrAssign(const K &key, T &&value) {
+        uint64_t hash = m_Hash(key);
+        size_t index = FindIndex(key, hash);
+        if(index != NotFound) {
+            m_Slots[index].Value = std::forward<T>(value);
+            return false;
+        }
+        Reserve(m_Size + 1);
+        InsertNew(key, hash, std::forward<T>(value));
+        return true;
+    }
+
+    // Bulk insert of `count` pairs from parallel ranges. The table grows at
+    // most once, and the hashes of each batch are computed and their groups
+    // prefetched before any of them is probed, so large random inserts
+    // overlap their cache misses.
+    template<typename KeyIterator, typename ValueIterator>
+    void InsertOrAssign(KeyIterator keys, ValueIterator values, size_t count) {
+        constexpr size_t Batch = 16;
+        Reserve(m_Size + count);
+
+        uint64_t hashes[Batch];
+        for(size_t first = 0; first < count; first += Batch) {
+            size_t batch = count - first < Batch ? count - first : Batch;
+            KeyIterator batchKeys = keys;
+            for(size_t i = 0; i < batch; i++, ++keys) {
+                hashes[i] = m_Hash(*keys);
+                PrefetchGroup(hashes[i]);
+            }
+            for(size_t i = 0; i < batch; i++, ++batchKeys, ++values) {
+                size_t index = FindIndex(*batchKeys, hashes[i]);
+                if(index != NotFound)
+                    m_Slots[index].Value = *values;
+                else
+                    InsertNew(*batchKeys, hashes[i], *values);
+            }
+        }
+    }
+
+    // Returns true if the key was present.
+    bool Erase(const K &key) {
+        size_t index = FindIndex(key, m_Hash(key));
+        if(index == NotFound)
+            return false;
+
+        m_Slots[index].~Slot();
+        m_Size--;
+        // Lookups stop at the first group with an empty slot, so no probe
+        // sequence runs through a group that already has one: the slot can
+        // become empty again instead of a tombstone.
+        const int8_t *group = m_Control + (index & ~(GroupWidth - 1));
+        if(Group(group).MatchEmpty()) {
+            m_Control[index] = Empty;
+        } else {
+            m_Control[index] = Deleted;
+            m_Deleted++;
+        }
+        return true;
+    }
+
+    // Calls func(key, value) for every entry, in table order.
+    template<typename Func>
+    void ForEach(Func &&func) {
+        for(size_t i = 0; i < m_Capacity; i++) {
+            if(IsFull(m_Control[i]))
+                func(static_cast<const K &>(m_Slots[i].Key), m_Slots[i].Value);
+        }
+    }
+    template<typename Func>
+    void ForEach(Func &&func) const {
+        for(size_t i = 0; i < m_Capacity; i++) {
+            if(IsFull(m_Control[i]))
+                func(static_cast<const K &>(m_Slots[i].Key), static_cast<const V &>(m_Slots[i].Value));
+        }
+    }
+
+    void Swap(FlatHashMap &other) noexcept {
+        std::swap(m_Control, other.m_Control);
+        std::swap(m_Slots, other.m_Slots);
+        std::swap(m_Capacity, other.m_Capacity);
+        std::swap(m_Size, other.m_Size);
+        std::swap(m_Deleted, other.m_Deleted);
+        std::swap(m_Hash, other.m_Hash);
+    }
+
+private:
+    struct Slot {
+        K Key;
+        V Value;
+    };
+
+    // Control bytes: full slots hold the low 7 bits of their hash, so the
+    // sign bit alone tells free from taken.
+    static constexpr int8_t Empty = -128;
+    static constexpr int8_t Deleted = -2;
+    static constexpr size_t NotFound = ~size_t(0);
+    static constexpr size_t Alignment = 64;
+
+    static bool IsFull(int8_t control) {
+        return control >= 0;
+    }
+
+    static int CountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return int(index);
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+    void PrefetchGroup(uint64_t hash) const {
+        size_t group = GroupIndex(hash) * GroupWidth;
+        Prefetch(m_Control + group);
+        Prefetch(m_Slots + group);
+    }
+
+    static void Prefetch(const void *address) {
+#if defined(VPP_FLAT_HASH_SSE2)
+        _mm_prefetch(static_cast<const char *>(address), _MM_HINT_T0);
+#elif defined(__GNUC__)
+        __builtin_prefetch(address);
+#else
+        (void)address;
+#endif
+    }
+
+    // Bit i of each mask is set when control byte i of the group matches.
+    struct Group {
+#if defined(VPP_FLAT_HASH_SSE2)
+        __m128i Control;
+
+        explicit Group(const int8_t *control)
+            : Control(_mm_load_si128(reinterpret_cast<const __m128i *>(control))) {}
+
+        uint32_t Match(int8_t tag) const {
+            return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(Control, _mm_set1_epi8(tag))));
+        }
+        uint32_t MatchEmpty() const {
+            return Match(Empty);
+        }
+        uint32_t MatchFree() const {
+            return uint32_t(_mm_movemask_epi8(Control));
+        }
+#else
+        const int8_t *Control;
+
+        explicit Group(const int8_t *control)
+            : Control(control) {}
+
+        uint32_t Match(int8_t tag) const {
+            uint32_t mask = 0;
+            for(size_t i = 0; i < GroupWidth; i++)
+                mask |= uint32_t(Control[i] == tag) << i;
+            return mask;
+        }
+        uint32_t MatchEmpty() const {
+            return Match(Empty);
+        }
+        uint32_t MatchFree() const {
+            uint32_t mask = 0;
+            for(size_t i = 0; i < GroupWidth; i++)
+                mask |= uint32_t(Control[i] < 0) << i;
+            return mask;
+        }
+#endif
+    };
+
+    static size_t MaxLoad(size_t capacity) {
+        return capacity - capacity / 8;
+    }
+
+    static size_t CapacityFor(size_t count) {
+        size_t capacity = GroupWidth;
+        while(MaxLoad(capacity) < count)
+            capacity *= 2;
+        return capacity;
+    }
+
+    size_t GroupIndex(uint64_t hash) const {
+        return size_t(hash >> 7) & (m_Capacity / GroupWidth - 1);
+    }
+
+    // Probes whole groups, stepping 1, 2, 3, ... groups further each time,
+    // which visits every group of a power-of-two table once.
+    size_t FindIndex(const K &key, uint64_t hash) const {
+        if(m_Capacity == 0)
+            return NotFound;
+        int8_t tag = int8_t(hash & 0x7f);
+        size_t groupMask = m_Capacity / GroupWidth - 1;
+        size_t group = GroupIndex(hash);
+        for(size_t step = 1;; step++) {
+            const int8_t *control = m_Control + group * GroupWidth;
+            Group probe(control);
+            for(uint32_t mask = probe.Match(tag); mask; mask &= mask - 1) {
+                size_t index = group * GroupWidth + size_t(CountTrailingZeros(mask));
+                if(m_Slots[index].Key == key)
+                    return index;
+            }
+            if(probe.MatchEmpty())
+                return NotFound;
+            group = (group + step) & groupMask;
+        }
+    }
+
+    // Stores a key known to be absent; the caller has reserved room.
+    template<typename T>
+    size_t InsertNew(const K &key, uint64_t hash, T &&value) {
+        size_t groupMask = m_Capacity / GroupWidth - 1;
+        size_t group = GroupIndex(hash);
+        for(size_t step = 1;; step++) {
+            uint32_t mask = Group(m_Control + group * GroupWidth).MatchFree();
+            if(mask) {
+                size_t index = group * GroupWidth + size_t(CountTrailingZeros(mask));
+                if(m_Control[index] == Deleted)
+                    m_Deleted--;
+                m_Control[index] = int8_t(hash & 0x7f);
+                new(&m_Slots[index]) Slot{key, std::forward<T>(value)};
+                m_Size++;
+                return index;
+            }
+            group = (group + step) & groupMask;
+        }
+    }
+
+    // Moves every entry into a fresh table of `capacity` slots, which also
+    // drops the tombstones. Entries land in random places of the new table,
+    // so they move in batches whose target groups are prefetched first.
+    void Rehash(size_t capacity) {
+        constexpr size_t Batch = 16;
+
+        int8_t *control = m_Control;
+        Slot *slots = m_Slots;
+        size_t oldCapacity = m_Capacity;
+
+        size_t controlBytes = (capacity + Alignment - 1) & ~(Alignment - 1);
+        char *memory = static_cast<char *>(::operator new(controlBytes + capacity * sizeof(Slot), std::align_val_t(Alignment)));
+        m_Control = reinterpret_cast<int8_t *>(memory);
+        m_Slots = reinterpret_cast<Slot *>(memory + controlBytes);
+        m_Capacity = capacity;
+        m_Size = 0;
+        m_Deleted = 0;
+        std::memset(m_Control, Empty, capacity);
+
+        size_t indices[Batch];
+        uint64_t hashes[Batch];
+        for(size_t i = 0; i < oldCapacity;) {
+            size_t batch = 0;
+            for(; i < oldCapacity && batch < Batch; i++) {
+                if(IsFull(control[i])) {
+                    indices[batch] = i;
+                    hashes[batch] = m_Hash(slots[i].Key);
+                    PrefetchGroup(hashes[batch++]);
+                }
+            }
+            for(size_t j = 0; j < batch; j++) {
+                Slot &slot = slots[indices[j]];
+                InsertNew(slot.Key, hashes[j], std::move(slot.Value));
+                slot.~Slot();
+            }
+        }
+        if(control)
+            ::operator delete(control, std::align_val_t(Alignment));
+    }
+
+    void Destroy() {
+        if(!m_Control)
+            return;
+        Clear();
+        ::operator delete(m_Control, std::align_val_t(Alignment));
+        m_Control = nullptr;
+        m_Slots = nullptr;
+        m_Capacity = 0;
+    }
+
+private:
+    int8_t *m_Control = nullptr;
+    Slot *m_Slots = nullptr;
+    size_t m_Capacity = 0;
+    size_t m_Size = 0;
+    // Tombstones; they count against the load factor until a rehash.
+    size_t m_Deleted = 0;
+    Hash m_Hash;
+};
+
+} // namespace VPP
@@ -3,7 +3,9 @@
 #include <entt/entt.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtx/quaternion.hpp>
+#include "PackedTransform.h"
 #include "Scene.h"
+#include "StringPool.h"
 #include "UUID.h"
 
 namespace VPP {
@@ -17,12 +19,16 @@ struct IDComponent {
     IDComponent(const IDComponent &) = default;
 };
 
+// The name is interned, so the component is a 32-bit handle: the pool is
+// plain data, and objects sharing a name share one copy of it.
 struct TagComponent {
-    std::string Tag;
+    InternedString Tag;
 
     TagComponent() = default;
     TagComponent(const TagComponent &) = default;
-    TagComponent(const std::string &tag)
+    TagComponent(InternedString tag)
+        : Tag(tag) {}
+    TagComponent(std::string_view tag)
         : Tag(tag) {}
 };
 
@@ -39,38 +45,80 @@ struct Transform {
     glm::mat4 GetTransform() const;
 };
 
+// Cached result of Transform::GetTransform(), rebuilt by
+// Scene::UpdateWorldTransforms() for objects tagged TransformDirty.
+struct WorldTransform {
+    glm::mat4 Matrix = glm::mat4(1.0f);
+
+    WorldTransform() = default;
+    WorldTransform(const WorldTransform &) = default;
+};
+
+struct TransformDirty {};
+
+// Parent/child links. Scene::UpdateWorldTransforms() puts the Hierarchy pool
+// in depth-first order whenever a link change left a parent behind one of
+// its children, so propagation always meets a parent first.
+struct Hierarchy {
+    entt::entity Parent{entt::null};
+    entt::entity FirstChild{entt::null};
+    entt::entity NextSibling{entt::null};
+    entt::entity PrevSibling{entt::null};
+
+    Hierarchy() = default;
+    Hierarchy(const Hierarchy &) = default;
+};
+
+template<typename... Component>
+struct ComponentGroup {};
+
+// Every component type the scene itself knows how to copy.
+using AllComponents = ComponentGroup<IDComponent, TagComponent, Transform, WorldTransform, TransformDirty, Hierarchy,
+                                     PackedTransform>;
+
 class GameObject {
 public:
     GameObject() = default;
     GameObject(entt::entity handle, Scene *scene);
     GameObject(const GameObject &other) = default;
 
+    // Component accessors return whatever the pool hands out: T & for
+    // ordinary components, a proxy such as PackedTransformRef for pools with
+    // a custom storage. They reach the pool through Scene::GetStorage().
     template<typename T, typename... Args>
-    T &AddComponent(Args &&...args) {
+    decltype(auto) AddComponent(Args &&...args) {
         assert(!HasComponent<T>());
-        T &component = m_Scene->m_Registry.emplace<T>(m_EntityHandle, std::forward<Args>(args)...);
-        return component;
+        return m_Scene->GetStorage<T>().emplace(m_EntityHandle, std::forward<Args>(args)...);
     }
 
     template<typename T, typename... Args>
-    T &AddOrReplaceComponent(Args &&...args) {
-        T &component = m_Scene->m_Registry.emplace_or_replace<T>(m_EntityHandle, std::forward<Args>(args)...);
-        return component;
+    decltype(auto) AddOrReplaceComponent(Args &&...args) {
+        auto &storage = m_Scene->GetStorage<T>();
+        if(storage.contains(m_EntityHandle))
+            return storage.patch(m_EntityHandle, [&args...](auto &...current) { ((current = T{std::forward<Args>(args)...}), ...); });
+        return storage.emplace(m_EntityHandle, std::forward<Args>(args)...);
+    }
+
+    // Modifies a component in place and notifies the scene, e.g. so a changed
+    // Transform gets its cached world matrix rebuilt.
+    template<typename T, typename... Func>
+    decltype(auto) PatchComponent(Func &&...func) {
+        return m_Scene->GetStorage<T>().patch(m_EntityHandle, std::forward<Func>(func)...);
     }
 
     template<typename T>
-    T &GetComponent() {
-        return m_Scene->m_Registry.get<T>(m_EntityHandle);
+    decltype(auto) GetComponent() {
+        return m_Scene->GetStorage<T>().get(m_EntityHandle);
     }
 
     template<typename T>
     bool HasComponent() {
-        return nullptr != m_Scene->m_Registry.try_get<T>(m_EntityHandle);
+        return m_Scene->GetStorage<T>().contains(m_EntityHandle);
     }
 
     template<typename T>
     void RemoveComponent() {
-        m_Scene->m_Registry.remove<T>(m_EntityHandle);
+        m_Scene->GetStorage<T>().remove(m_EntityHandle);
     }
 
     operator bool() const {
@@ -86,8 +134,24 @@ public:
     UUID GetUUID() {
         return GetComponent<IDComponent>().ID;
     }
-    const std::string &GetName() {
-        return GetComponent<TagComponent>().Tag;
+    std::string_view GetName() {
+        return GetComponent<TagComponent>().Tag.View();
+    }
+    // Renames go through patch() so the scene's name index sees them;
+    // writing TagComponent::Tag directly leaves the index stale.
+    void SetName(std::string_view name) {
+        InternedString tag(name);
+        m_Scene->GetStorage<TagComponent>().patch(m_EntityHandle, [tag](TagComponent &tc) { tc.Tag = tag; });
+    }
+
+    void SetParent(GameObject parent) {
+        m_Scene->SetParent(*this, parent);
+    }
+    GameObject GetParent() {
+        auto &hierarchy = m_Scene->GetStorage<Hierarchy>();
+        if(!hierarchy.contains(m_EntityHandle) || hierarchy.get(m_EntityHandle).Parent == entt::null)
+            return {};
+        return {hierarchy.get(m_EntityHandle).Parent, m_Scene};
     }
 
     bool operator==(const GameObject &other) const {
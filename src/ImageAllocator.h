@@ -0,0 +1,39 @@
+#pragma once
+
+// Internal: the allocation functions third/stb_image/stb_image.cpp builds
+// stb_image with, so a decode can place its output in a caller's buffer.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace VPP {
+
+void *ImageMalloc(size_t size);
+void *ImageRealloc(void *pointer, size_t size);
+void ImageFree(void *pointer);
+
+// While alive, the first stb_image allocation on this thread of exactly
+// `size` bytes is served from `buffer` instead of the heap. For the
+// formats stb decodes straight into its output allocation that is the
+// decoded image itself; others produce a heap result that the caller has
+// to copy (check the returned pointer against `buffer`).
+class ImageOutputScope {
+public:
+    ImageOutputScope(uint8_t *buffer, size_t size);
+    ~ImageOutputScope();
+
+    ImageOutputScope(const ImageOutputScope &) = delete;
+    ImageOutputScope &operator=(const ImageOutputScope &) = delete;
+
+private:
+    ImageOutputScope *m_Previous;
+    uint8_t *m_Buffer;
+    size_t m_Size;
+    bool m_InUse = false;
+
+    friend void *ImageMalloc(size_t size);
+    friend void *ImageRealloc(void *pointer, size_t size);
+    friend void ImageFree(void *pointer);
+};
+
+} // namespace VPP
@@ -0,0 +1,324 @@
+#include "ImageOps.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+#include "CpuFeatures.h"
+#include "ImageOpsSimd.h"
+#include "ThreadPool.h"
+
+namespace VPP {
+
+namespace {
+
+// Pixels one task processes; images (or runs of pixels) up to this size
+// never leave the calling thread.
+constexpr size_t ImageTaskPixels = 16384;
+
+uint32_t GetMipDimension(uint32_t size, uint32_t level) {
+    uint32_t scaled = size >> level;
+    return scaled > 0 ? scaled : 1;
+}
+
+ImageKernels SelectImageKernels() {
+#if defined(VPP_HAS_AVX2_KERNEL)
+    if(CpuSupportsAVX2())
+        return GetImageKernelsAVX2();
+#endif
+#if defined(VPP_IMAGE_LANES_SSE2)
+    return MakeImageKernels<SSE2PixelLanes>("sse2");
+#else
+    return MakeImageKernels<ScalarPixelLanes>("scalar");
+#endif
+}
+
+std::atomic<bool> s_UseScalarKernels{false};
+
+const ImageKernels &GetImageKernels() {
+    static const ImageKernels s_Selected = SelectImageKernels();
+    static const ImageKernels s_Scalar = MakeImageKernels<ScalarPixelLanes>("scalar");
+    return s_UseScalarKernels.load(std::memory_order_relaxed) ? s_Scalar : s_Selected;
+}
+
+// Output pixel x of a 2:1 reduction reads source pixels 2x + First + k.
+struct FilterTaps {
+    int First;
+    size_t Count;
+    float Weights[6];
+};
+
+double BesselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for(int k = 1; term > sum * 1e-12; k++) {
+        double factor = x / (2.0 * k);
+        term *= factor * factor;
+        sum += term;
+    }
+    return sum;
+}
+
+FilterTaps MakeKaiserTaps() {
+    // Source pixel 2x - 2 + k is centred (k - 2.5) / 2 output pixels away
+    // from output pixel x; the window reaches 1.5 output pixels out.
+    const double pi = 3.14159265358979323846;
+    const double radius = 1.5, beta = 4.0;
+
+    FilterTaps taps = {-2, 6, {}};
+    double weights[6], sum = 0.0;
+    for(size_t k = 0; k < taps.Count; k++) {
+        double t = (double(k) - 2.5) * 0.5;
+        double ratio = t / radius;
+        double sinc = std::sin(pi * t) / (pi * t);
+        weights[k] = sinc * BesselI0(beta * std::sqrt(1.0 - ratio * ratio)) / BesselI0(beta);
+        sum += weights[k];
+    }
+    for(size_t k = 0; k < taps.Count; k++)
+        taps.Weights[k] = float(weights[k] / sum);
+    return taps;
+}
+
+const FilterTaps &GetFilterTaps(MipFilter filter) {
+    static const FilterTaps s_Box = {0, 2, {0.5f, 0.5f}};
+    static const FilterTaps s_Kaiser = MakeKaiserTaps();
+    return filter == MipFilter::Kaiser ? s_Kaiser : s_Box;
+}
+
+constexpr size_t SRGBGuessCount = 4096;
+
+struct SRGBTables {
+    // Kernel decode table: R, G and B from sRGB, then A as is.
+    float Decode[1024];
+    // Thresholds[c] is the smallest linear value that rounds to code c.
+    float Thresholds[256];
+    // A code within one of the right one for linear values from
+    // i / (SRGBGuessCount - 1) up.
+    uint8_t Guess[SRGBGuessCount];
+};
+
+double SRGBToLinear(double v) {
+    return v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4);
+}
+
+double LinearToSRGB(double v) {
+    return v <= 0.0031308 ? v * 12.92 : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055;
+}
+
+SRGBTables MakeSRGBTables() {
+    SRGBTables tables;
+    for(int c = 0; c < 256; c++) {
+        float linear = float(SRGBToLinear(c / 255.0));
+        tables.Decode[c] = tables.Decode[256 + c] = tables.Decode[512 + c] = linear;
+        tables.Decode[768 + c] = c / 255.0f;
+        tables.Thresholds[c] = c == 0 ? 0.0f : float(SRGBToLinear((c - 0.5) / 255.0));
+    }
+    for(size_t i = 0; i < SRGBGuessCount; i++)
+        tables.Guess[i] = uint8_t(std::lround(LinearToSRGB(double(i) / (SRGBGuessCount - 1)) * 255.0));
+    return tables;
+}
+
+const SRGBTables &GetSRGBTables() {
+    static const SRGBTables s_Tables = MakeSRGBTables();
+    return s_Tables;
+}
+
+uint8_t EncodeSRGB(const SRGBTables &tables, float linear) {
+    if(!(linear > 0.0f))
+        return 0;
+    if(linear >= 1.0f)
+        return 255;
+
+    int code = tables.Guess[size_t(linear * (SRGBGuessCount - 1))];
+    while(code < 255 && linear >= tables.Thresholds[code + 1])
+        code++;
+    while(code > 0 && linear < tables.Thresholds[code])
+        code--;
+    return uint8_t(code);
+}
+
+void DownsampleBoxRows(const ImageKernels &kernels, const uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst,
+                       uint32_t firstRow, uint32_t lastRow) {
+    uint32_t dstWidth = GetMipDimension(width, 1);
+    size_t stride = size_t(width) * 4;
+
+    for(uint32_t y = firstRow; y < lastRow; y++) {
+        const uint8_t *row0 = src + size_t(2 * y < height ? 2 * y : height - 1) * stride;
+        const uint8_t *row1 = src + size_t(2 * y + 1 < height ? 2 * y + 1 : height - 1) * stride;
+        uint8_t *out = dst + size_t(y) * dstWidth * 4;
+
+        if(width >= 2) {
+            kernels.DownsampleBoxRow(row0, row1, out, dstWidth);
+        } else {
+            for(size_t c = 0; c < 4; c++)
+                out[c] = uint8_t((2 * row0[c] + 2 * row1[c] + 2) >> 2);
+        }
+    }
+}
+
+// Separable filter in float: the taps' source rows are summed into one row
+// (decoding sRGB on the way), which is padded with copies of its edge
+// pixels and then filtered horizontally.
+void DownsampleFilteredRows(const ImageKernels &kernels, const uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst,
+                            const DownsampleOptions &options, uint32_t firstRow, uint32_t lastRow) {
+    const FilterTaps &taps = GetFilterTaps(options.Filter);
+    const SRGBTables *srgb = options.SRGB ? &GetSRGBTables() : nullptr;
+    uint32_t dstWidth = GetMipDimension(width, 1);
+    size_t stride = size_t(width) * 4;
+
+    int64_t reach = 2 * int64_t(dstWidth) - 2 + taps.First + int64_t(taps.Count);
+    size_t left = size_t(-taps.First);
+    size_t right = reach > int64_t(width) ? size_t(reach - width) : 0;
+    std::vector<float> row((left + width + right) * 4);
+    std::vector<float> filtered(size_t(dstWidth) * 4);
+    float *center = row.data() + left * 4;
+
+    for(uint32_t y = firstRow; y < lastRow; y++) {
+        std::fill(center, center + stride, 0.0f);
+        for(size_t k = 0; k < taps.Count; k++) {
+            int64_t sourceRow = std::clamp<int64_t>(2 * int64_t(y) + taps.First + int64_t(k), 0, height - 1);
+            kernels.AccumulateRow(src + size_t(sourceRow) * stride, stride, taps.Weights[k], srgb ? srgb->Decode : nullptr, center);
+        }
+        for(size_t i = 0; i < left; i++)
+            std::copy(center, center + 4, row.data() + i * 4);
+        for(size_t i = 0; i < right; i++)
+            std::copy(center + stride - 4, center + stride, center + stride + i * 4);
+
+        kernels.FilterRow(row.data(), taps.Weights, taps.Count, filtered.data(), dstWidth);
+
+        uint8_t *out = dst + size_t(y) * dstWidth * 4;
+        kernels.EncodeRow(filtered.data(), filtered.size(), out);
+        if(srgb) {
+            for(size_t x = 0; x < dstWidth; x++) {
+                for(size_t c = 0; c < 3; c++)
+                    out[x * 4 + c] = EncodeSRGB(*srgb, filtered[x * 4 + c]);
+            }
+        }
+    }
+}
+
+void DownsampleRows(const ImageKernels &kernels, const uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst,
+                    const DownsampleOptions &options, uint32_t firstRow, uint32_t lastRow) {
+    if(options.Filter == MipFilter::Box && !options.SRGB)
+        DownsampleBoxRows(kernels, src, width, height, dst, firstRow, lastRow);
+    else
+        DownsampleFilteredRows(kernels, src, width, height, dst, options, firstRow, lastRow);
+}
+
+// Calls func(begin, end) for consecutive pieces of [0, count) of at most
+// `grain` items, on `pool` when there is more than one piece.
+template<typename Func>
+void ParallelRanges(ThreadPool &pool, size_t count, size_t grain, Func func) {
+    if(count <= grain) {
+        func(size_t(0), count);
+        return;
+    }
+
+    TaskGroup group;
+    for(size_t begin = 0; begin < count; begin += grain) {
+        size_t end = begin + grain < count ? begin + grain : count;
+        pool.Submit(group, [begin, end, &func] { func(begin, end); });
+    }
+    pool.Wait(group);
+}
+
+} // namespace
+
+uint32_t GetMipCount(uint32_t width, uint32_t height) {
+    uint32_t count = 1;
+    for(uint32_t size = width > height ? width : height; size > 1; size >>= 1)
+        count++;
+    return count;
+}
+
+size_t GetMipChainSize(uint32_t width, uint32_t height, uint32_t channels) {
+    return GetMipOffset(width, height, channels, GetMipCount(width, height));
+}
+
+size_t GetMipOffset(uint32_t width, uint32_t height, uint32_t channels, uint32_t level) {
+    size_t offset = 0;
+    for(uint32_t i = 0; i < level; i++)
+        offset += size_t(GetMipDimension(width, i)) * GetMipDimension(height, i) * channels;
+    return offset;
+}
+
+void DownsampleRGBA8(const uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst, const DownsampleOptions &options) {
+    DownsampleRows(GetImageKernels(), src, width, height, dst, options, 0, GetMipDimension(height, 1));
+}
+
+void DownsampleRGBA8(ThreadPool &pool, const uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst,
+                     const DownsampleOptions &options) {
+    const ImageKernels &kernels = GetImageKernels();
+    size_t rows = ImageTaskPixels / GetMipDimension(width, 1);
+    ParallelRanges(pool, GetMipDimension(height, 1), rows > 0 ? rows : 1, [&](size_t begin, size_t end) {
+        DownsampleRows(kernels, src, width, height, dst, options, uint32_t(begin), uint32_t(end));
+    });
+}
+
+void GenerateMipChainRGBA8(uint8_t *chain, uint32_t width, uint32_t height, const DownsampleOptions &options) {
+    uint32_t count = GetMipCount(width, height);
+    uint8_t *level = chain;
+    for(uint32_t i = 1; i < count; i++) {
+        uint32_t levelWidth = GetMipDimension(width, i - 1);
+        uint32_t levelHeight = GetMipDimension(height, i - 1);
+        uint8_t *next = level + size_t(levelWidth) * levelHeight * 4;
+        DownsampleRGBA8(level, levelWidth, levelHeight, next, options);
+        level = next;
+    }
+}
+
+void GenerateMipChainRGBA8(ThreadPool &pool, uint8_t *chain, uint32_t width, uint32_t height,
+                           const DownsampleOptions &options) {
+    // Every level reads the one before, so only the rows of a level run in
+    // parallel.
+    uint32_t count = GetMipCount(width, height);
+    uint8_t *level = chain;
+    for(uint32_t i = 1; i < count; i++) {
+        uint32_t levelWidth = GetMipDimension(width, i - 1);
+        uint32_t levelHeight = GetMipDimension(height, i - 1);
+        uint8_t *next = level + size_t(levelWidth) * levelHeight * 4;
+        DownsampleRGBA8(pool, level, levelWidth, levelHeight, next, options);
+        level = next;
+    }
+}
+
+void SwizzleRGBA8(const uint8_t *src, size_t pixels, const std::array<uint8_t, 4> &order, uint8_t *dst) {
+    GetImageKernels().Swizzle(src, pixels, order.data(), dst);
+}
+
+void SwizzleRGBA8(ThreadPool &pool, const uint8_t *src, size_t pixels, const std::array<uint8_t, 4> &order, uint8_t *dst) {
+    const ImageKernels &kernels = GetImageKernels();
+    ParallelRanges(pool, pixels, ImageTaskPixels, [&](size_t begin, size_t end) {
+        kernels.Swizzle(src + begin * 4, end - begin, order.data(), dst + begin * 4);
+    });
+}
+
+void PremultiplyAlphaRGBA8(const uint8_t *src, size_t pixels, uint8_t *dst) {
+    GetImageKernels().Premultiply(src, pixels, dst);
+}
+
+void PremultiplyAlphaRGBA8(ThreadPool &pool, const uint8_t *src, size_t pixels, uint8_t *dst) {
+    const ImageKernels &kernels = GetImageKernels();
+    ParallelRanges(pool, pixels, ImageTaskPixels, [&](size_t begin, size_t end) {
+        kernels.Premultiply(src + begin * 4, end - begin, dst + begin * 4);
+    });
+}
+
+void ConvertRGBA8ToRGB565(const uint8_t *src, size_t pixels, uint16_t *dst) {
+    GetImageKernels().ConvertRGB565(src, pixels, dst);
+}
+
+void ConvertRGBA8ToRGB565(ThreadPool &pool, const uint8_t *src, size_t pixels, uint16_t *dst) {
+    const ImageKernels &kernels = GetImageKernels();
+    ParallelRanges(pool, pixels, ImageTaskPixels, [&](size_t begin, size_t end) {
+        kernels.ConvertRGB565(src + begin * 4, end - begin, dst + begin);
+    });
+}
+
+const char *GetImageKernelName() {
+    return GetImageKernels().Name;
+}
+
+void SetImageKernelsScalar(bool scalar) {
+    s_UseScalarKernels.store(scalar, std::memory_order_relaxed);
+}
+
+} // namespace VPP
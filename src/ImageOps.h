@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace VPP {
+
+class ThreadPool;
+
+// Mip chains are stored level after level in one block, level 0 first,
+// each level half the size of the previous one (rounded down, at least 1).
+
+uint32_t GetMipCount(uint32_t width, uint32_t height);
+size_t GetMipChainSize(uint32_t width, uint32_t height, uint32_t channels);
+size_t GetMipOffset(uint32_t width, uint32_t height, uint32_t channels, uint32_t level);
+
+enum class MipFilter {
+    // 2x2 average.
+    Box,
+    // 6x6 Kaiser-windowed sinc; sharper than Box, with less aliasing.
+    Kaiser
+};
+
+struct DownsampleOptions {
+    MipFilter Filter = MipFilter::Box;
+    // Treat red, green and blue as sRGB encoded and filter them in linear
+    // space; alpha is always linear.
+    bool SRGB = false;
+};
+
+// The image functions below run on the widest kernels the CPU supports
+// (AVX2 or SSE2, picked once at runtime) and fall back to scalar code
+// elsewhere. The ThreadPool overloads split the work into bands of rows
+// (or runs of pixels) and block until all are done; small images are
+// processed on the calling thread.
+
+// Halves an RGBA8 image. The last row or column of an odd-sized image
+// (and the filter taps past the edges) repeat the edge pixels.
+void DownsampleRGBA8(const uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst,
+                     const DownsampleOptions &options = {});
+void DownsampleRGBA8(ThreadPool &pool, const uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst,
+                     const DownsampleOptions &options = {});
+
+// Fills levels 1 and up of an RGBA8 chain whose level 0 is already set.
+void GenerateMipChainRGBA8(uint8_t *chain, uint32_t width, uint32_t height, const DownsampleOptions &options = {});
+void GenerateMipChainRGBA8(ThreadPool &pool, uint8_t *chain, uint32_t width, uint32_t height,
+                           const DownsampleOptions &options = {});
+
+// Channel c of every output pixel is channel order[c] of the input pixel,
+// e.g. {2, 1, 0, 3} turns RGBA into BGRA. src and dst may be the same.
+void SwizzleRGBA8(const uint8_t *src, size_t pixels, const std::array<uint8_t, 4> &order, uint8_t *dst);
+void SwizzleRGBA8(ThreadPool &pool, const uint8_t *src, size_t pixels, const std::array<uint8_t, 4> &order, uint8_t *dst);
+
+// Multiplies red, green and blue by alpha, rounded to nearest. src and dst
+// may be the same.
+void PremultiplyAlphaRGBA8(const uint8_t *src, size_t pixels, uint8_t *dst);
+void PremultiplyAlphaRGBA8(ThreadPool &pool, const uint8_t *src, size_t pixels, uint8_t *dst);
+
+// Packs RGBA8 into RGB565 (red in the high bits), rounded to nearest;
+// alpha is dropped.
+void ConvertRGBA8ToRGB565(const uint8_t *src, size_t pixels, uint16_t *dst);
+void ConvertRGBA8ToRGB565(ThreadPool &pool, const uint8_t *src, size_t pixels, uint16_t *dst);
+
+// Name of the kernels the functions above dispatch to.
+const char *GetImageKernelName();
+
+// Makes the functions above use the scalar kernels (or stop doing so), for
+// comparing against them. Not meant to be flipped while images are being
+// processed.
+void SetImageKernelsScalar(bool scalar);
+
+} // namespace VPP
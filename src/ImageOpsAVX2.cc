@@ -0,0 +1,11 @@
+#include "ImageOpsSimd.h"
+
+namespace VPP {
+
+#if defined(VPP_IMAGE_LANES_AVX2)
+ImageKernels GetImageKernelsAVX2() {
+    return MakeImageKernels<AVX2PixelLanes>("avx2");
+}
+#endif
+
+} // namespace VPP
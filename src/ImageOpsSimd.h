@@ -0,0 +1,398 @@
+#pragma once
+
+// Internal to ImageOps*.cc. Like TransformBatchSimd.h, every translation
+// unit that includes this header gets its own copy of the kernels
+// (anonymous namespace), so units built with different instruction-set
+// flags never share an inline function.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#include <immintrin.h>
+#define VPP_IMAGE_LANES_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VPP_IMAGE_LANES_SSE2 1
+#endif
+
+namespace VPP {
+
+// Row kernels behind the functions of ImageOps.h, one table per
+// instruction set. Counts are in bytes (floats for float rows) unless
+// they say pixels.
+struct ImageKernels {
+    // Box filters two source rows of an image at least 2 pixels wide.
+    void (*DownsampleBoxRow)(const uint8_t *row0, const uint8_t *row1, uint8_t *out, uint32_t outWidth);
+    // acc[i] += weight * decode(src[i]); decode is byte / 255 without a
+    // table, or table[(i % 4) * 256 + src[i]] with one.
+    void (*AccumulateRow)(const uint8_t *src, size_t count, float weight, const float *table, float *acc);
+    // out pixel x = sum of weights[k] * src pixel 2x + k.
+    void (*FilterRow)(const float *src, const float *weights, size_t taps, float *out, uint32_t outWidth);
+    // dst[i] = round(clamp(src[i], 0, 1) * 255).
+    void (*EncodeRow)(const float *src, size_t count, uint8_t *dst);
+    void (*Swizzle)(const uint8_t *src, size_t pixels, const uint8_t *order, uint8_t *dst);
+    void (*Premultiply)(const uint8_t *src, size_t pixels, uint8_t *dst);
+    void (*ConvertRGB565)(const uint8_t *src, size_t pixels, uint16_t *dst);
+    const char *Name;
+};
+
+// Defined in ImageOpsAVX2.cc, which is built with AVX2/FMA enabled.
+ImageKernels GetImageKernelsAVX2();
+
+namespace {
+
+// Integer vectors hold `Width` RGBA8 pixels, one per 32-bit lane; the
+// 16-bit operations treat each lane as two 16-bit halves and are only used
+// where no half can carry into the next. Float vectors hold `FloatWidth`
+// consecutive channels.
+struct ScalarPixelLanes {
+    static constexpr size_t Width = 1;
+    static constexpr size_t FloatWidth = 1;
+    using Vec = uint32_t;
+    using FVec = float;
+
+    static Vec Load(const uint8_t *p) {
+        Vec v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    static void Store(uint8_t *p, Vec v) { std::memcpy(p, &v, sizeof(v)); }
+    static Vec Set32(uint32_t v) { return v; }
+    static Vec And(Vec a, Vec b) { return a & b; }
+    static Vec Or(Vec a, Vec b) { return a | b; }
+    static Vec Add16(Vec a, Vec b) { return a + b; }
+    static Vec Add32(Vec a, Vec b) { return a + b; }
+    static Vec Mul16(Vec a, Vec b) {
+        return ((a & 0xFFFF) * (b & 0xFFFF) & 0xFFFF) | ((a >> 16) * (b >> 16) << 16);
+    }
+    template<int N>
+    static Vec Srl16(Vec v) { return (v >> N) & ((0xFFFFu >> N) * 0x10001u); }
+    template<int N>
+    static Vec Sll16(Vec v) { return (v << N) & (((0xFFFFu << N) & 0xFFFFu) * 0x10001u); }
+    template<int N>
+    static Vec Srl32(Vec v) { return v >> N; }
+    template<int N>
+    static Vec Sll32(Vec v) { return v << N; }
+    static Vec SrlVar32(Vec v, int n) { return v >> n; }
+    static Vec SllVar32(Vec v, int n) { return v << n; }
+    // Even and odd pixels of the 2 * Width pixels in a, b.
+    static Vec Even(Vec a, Vec) { return a; }
+    static Vec Odd(Vec, Vec b) { return b; }
+    // Packs the low 16 bits of every lane of a, then b, into one vector.
+    static Vec Narrow32To16(Vec a, Vec b) { return (a & 0xFFFF) | (b << 16); }
+
+    static FVec FSet(float v) { return v; }
+    static FVec FLoad(const float *p) { return *p; }
+    static void FStore(float *p, FVec v) { *p = v; }
+    static FVec FAdd(FVec a, FVec b) { return a + b; }
+    static FVec FMul(FVec a, FVec b) { return a * b; }
+    static FVec FMulAdd(FVec a, FVec b, FVec c) { return a * b + c; }
+    static FVec FLoadBytes(const uint8_t *p) { return float(*p); }
+    static FVec FLoadTable(const float *table, const uint8_t *p, size_t channel) { return table[(channel & 3) << 8 | *p]; }
+    // Channel i comes from p[i / 4 * 8 + i % 4]: the same channels of
+    // every other pixel.
+    static FVec FLoadPixels(const float *p) { return *p; }
+    static void FStoreBytes(uint8_t *p, FVec v) {
+        v = v < 0.0f ? 0.0f : (v > 255.0f ? 255.0f : v);
+        *p = static_cast<uint8_t>(std::nearbyint(v));
+    }
+};
+
+#if defined(VPP_IMAGE_LANES_SSE2)
+struct SSE2PixelLanes {
+    static constexpr size_t Width = 4;
+    static constexpr size_t FloatWidth = 4;
+    using Vec = __m128i;
+    using FVec = __m128;
+
+    static Vec Load(const uint8_t *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+    static void Store(uint8_t *p, Vec v) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v); }
+    static Vec Set32(uint32_t v) { return _mm_set1_epi32(static_cast<int>(v)); }
+    static Vec And(Vec a, Vec b) { return _mm_and_si128(a, b); }
+    static Vec Or(Vec a, Vec b) { return _mm_or_si128(a, b); }
+    static Vec Add16(Vec a, Vec b) { return _mm_add_epi16(a, b); }
+    static Vec Add32(Vec a, Vec b) { return _mm_add_epi32(a, b); }
+    static Vec Mul16(Vec a, Vec b) { return _mm_mullo_epi16(a, b); }
+    template<int N>
+    static Vec Srl16(Vec v) { return _mm_srli_epi16(v, N); }
+    template<int N>
+    static Vec Sll16(Vec v) { return _mm_slli_epi16(v, N); }
+    template<int N>
+    static Vec Srl32(Vec v) { return _mm_srli_epi32(v, N); }
+    template<int N>
+    static Vec Sll32(Vec v) { return _mm_slli_epi32(v, N); }
+    static Vec SrlVar32(Vec v, int n) { return _mm_srl_epi32(v, _mm_cvtsi32_si128(n)); }
+    static Vec SllVar32(Vec v, int n) { return _mm_sll_epi32(v, _mm_cvtsi32_si128(n)); }
+    static Vec Even(Vec a, Vec b) {
+        return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0)));
+    }
+    static Vec Odd(Vec a, Vec b) {
+        return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    // packs_epi32 saturates signed values; bias into the signed range and back.
+    static Vec Narrow32To16(Vec a, Vec b) {
+        __m128i bias32 = _mm_set1_epi32(0x8000);
+        __m128i packed = _mm_packs_epi32(_mm_sub_epi32(a, bias32), _mm_sub_epi32(b, bias32));
+        return _mm_xor_si128(packed, _mm_set1_epi16(static_cast<short>(0x8000)));
+    }
+
+    static FVec FSet(float v) { return _mm_set1_ps(v); }
+    static FVec FLoad(const float *p) { return _mm_loadu_ps(p); }
+    static void FStore(float *p, FVec v) { _mm_storeu_ps(p, v); }
+    static FVec FAdd(FVec a, FVec b) { return _mm_add_ps(a, b); }
+    static FVec FMul(FVec a, FVec b) { return _mm_mul_ps(a, b); }
+    static FVec FMulAdd(FVec a, FVec b, FVec c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static FVec FLoadBytes(const uint8_t *p) {
+        int32_t bytes;
+        std::memcpy(&bytes, p, sizeof(bytes));
+        __m128i zero = _mm_setzero_si128();
+        __m128i wide = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+        return _mm_cvtepi32_ps(wide);
+    }
+    // Starts on a pixel, so channels are R, G, B, A.
+    static FVec FLoadTable(const float *table, const uint8_t *p, size_t) {
+        return _mm_setr_ps(table[p[0]], table[256 + p[1]], table[512 + p[2]], table[768 + p[3]]);
+    }
+    static FVec FLoadPixels(const float *p) { return _mm_loadu_ps(p); }
+    static void FStoreBytes(uint8_t *p, FVec v) {
+        __m128i words = _mm_packs_epi32(_mm_cvtps_epi32(v), _mm_setzero_si128());
+        int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+        std::memcpy(p, &bytes, sizeof(bytes));
+    }
+};
+#endif
+
+#if defined(VPP_IMAGE_LANES_AVX2)
+struct AVX2PixelLanes {
+    static constexpr size_t Width = 8;
+    static constexpr size_t FloatWidth = 8;
+    using Vec = __m256i;
+    using FVec = __m256;
+
+    static Vec Load(const uint8_t *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+    static void Store(uint8_t *p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+    static Vec Set32(uint32_t v) { return _mm256_set1_epi32(static_cast<int>(v)); }
+    static Vec And(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+    static Vec Or(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+    static Vec Add16(Vec a, Vec b) { return _mm256_add_epi16(a, b); }
+    static Vec Add32(Vec a, Vec b) { return _mm256_add_epi32(a, b); }
+    static Vec Mul16(Vec a, Vec b) { return _mm256_mullo_epi16(a, b); }
+    template<int N>
+    static Vec Srl16(Vec v) { return _mm256_srli_epi16(v, N); }
+    template<int N>
+    static Vec Sll16(Vec v) { return _mm256_slli_epi16(v, N); }
+    template<int N>
+    static Vec Srl32(Vec v) { return _mm256_srli_epi32(v, N); }
+    template<int N>
+    static Vec Sll32(Vec v) { return _mm256_slli_epi32(v, N); }
+    static Vec SrlVar32(Vec v, int n) { return _mm256_srl_epi32(v, _mm_cvtsi32_si128(n)); }
+    static Vec SllVar32(Vec v, int n) { return _mm256_sll_epi32(v, _mm_cvtsi32_si128(n)); }
+    // The shuffles and packs work within 128-bit halves; the permute puts
+    // the 64-bit quarters back in order.
+    static Vec Even(Vec a, Vec b) {
+        __m256 even = _mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(2, 0, 2, 0));
+        return _mm256_permute4x64_epi64(_mm256_castps_si256(even), _MM_SHUFFLE(3, 1, 2, 0));
+    }
+    static Vec Odd(Vec a, Vec b) {
+        __m256 odd = _mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(3, 1, 3, 1));
+        return _mm256_permute4x64_epi64(_mm256_castps_si256(odd), _MM_SHUFFLE(3, 1, 2, 0));
+    }
+    static Vec Narrow32To16(Vec a, Vec b) {
+        __m256i bias32 = _mm256_set1_epi32(0x8000);
+        __m256i packed = _mm256_packs_epi32(_mm256_sub_epi32(a, bias32), _mm256_sub_epi32(b, bias32));
+        packed = _mm256_xor_si256(packed, _mm256_set1_epi16(static_cast<short>(0x8000)));
+        return _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+    }
+
+    static FVec FSet(float v) { return _mm256_set1_ps(v); }
+    static FVec FLoad(const float *p) { return _mm256_loadu_ps(p); }
+    static void FStore(float *p, FVec v) { _mm256_storeu_ps(p, v); }
+    static FVec FAdd(FVec a, FVec b) { return _mm256_add_ps(a, b); }
+    static FVec FMul(FVec a, FVec b) { return _mm256_mul_ps(a, b); }
+    static FVec FMulAdd(FVec a, FVec b, FVec c) { return _mm256_fmadd_ps(a, b, c); }
+    static FVec FLoadBytes(const uint8_t *p) {
+        return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))));
+    }
+    static FVec FLoadTable(const float *table, const uint8_t *p, size_t) {
+        __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+        index = _mm256_or_si256(index, _mm256_setr_epi32(0, 256, 512, 768, 0, 256, 512, 768));
+        return _mm256_i32gather_ps(table, index, 4);
+    }
+    static FVec FLoadPixels(const float *p) {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 8), 1);
+    }
+    static void FStoreBytes(uint8_t *p, FVec v) {
+        __m256i words = _mm256_cvtps_epi32(v);
+        __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm_packus_epi16(packed, packed));
+    }
+};
+#endif
+
+// round(v / 255) for v <= 255 * 255, per 16-bit half.
+template<typename L>
+inline typename L::Vec DivideBy255(typename L::Vec v) {
+    v = L::Add16(v, L::Set32(0x00800080));
+    return L::template Srl16<8>(L::Add16(v, L::template Srl16<8>(v)));
+}
+
+// 2x2 box filter of Width output pixels, the same rounding as the scalar
+// DownsampleRGBA8 always had: (a + b + c + d + 2) / 4 per channel.
+template<typename L>
+inline void DownsampleBoxBlock(const uint8_t *row0, const uint8_t *row1, uint8_t *out) {
+    using Vec = typename L::Vec;
+
+    Vec a0 = L::Load(row0), a1 = L::Load(row0 + L::Width * 4);
+    Vec b0 = L::Load(row1), b1 = L::Load(row1 + L::Width * 4);
+    Vec pixels[4] = {L::Even(a0, a1), L::Odd(a0, a1), L::Even(b0, b1), L::Odd(b0, b1)};
+
+    // Red and blue in the low bytes of the 16-bit halves, green and alpha
+    // in the high ones; four bytes sum to at most 1020.
+    Vec mask = L::Set32(0x00FF00FF);
+    Vec low = L::Set32(0x00020002), high = low;
+    for(Vec pixel: pixels) {
+        low = L::Add16(low, L::And(pixel, mask));
+        high = L::Add16(high, L::template Srl16<8>(pixel));
+    }
+    low = L::template Srl16<2>(low);
+    high = L::template Srl16<2>(high);
+    L::Store(out, L::Or(low, L::template Sll16<8>(high)));
+}
+
+template<typename L>
+inline void DownsampleBoxRowWith(const uint8_t *row0, const uint8_t *row1, uint8_t *out, uint32_t outWidth) {
+    size_t x = 0;
+    for(; x + L::Width <= outWidth; x += L::Width)
+        DownsampleBoxBlock<L>(row0 + x * 8, row1 + x * 8, out + x * 4);
+    for(; x < outWidth; x++)
+        DownsampleBoxBlock<ScalarPixelLanes>(row0 + x * 8, row1 + x * 8, out + x * 4);
+}
+
+template<typename L>
+inline void AccumulateRowWith(const uint8_t *src, size_t count, float weight, const float *table, float *acc) {
+    size_t i = 0;
+    if(table) {
+        typename L::FVec scale = L::FSet(weight);
+        for(; i + L::FloatWidth <= count; i += L::FloatWidth)
+            L::FStore(acc + i, L::FMulAdd(L::FLoadTable(table, src + i, i), scale, L::FLoad(acc + i)));
+    } else {
+        typename L::FVec scale = L::FSet(weight / 255.0f);
+        for(; i + L::FloatWidth <= count; i += L::FloatWidth)
+            L::FStore(acc + i, L::FMulAdd(L::FLoadBytes(src + i), scale, L::FLoad(acc + i)));
+    }
+    if(i < count)
+        AccumulateRowWith<ScalarPixelLanes>(src + i, count - i, weight, table, acc + i);
+}
+
+template<typename L>
+inline void FilterRowWith(const float *src, const float *weights, size_t taps, float *out, uint32_t outWidth) {
+    size_t count = size_t(outWidth) * 4;
+    size_t i = 0;
+    for(; i + L::FloatWidth <= count; i += L::FloatWidth) {
+        // Output channel i reads channel i % 4 of source pixels 2 * (i / 4) + k.
+        const float *base = src + (i / 4) * 8 + i % 4;
+        typename L::FVec sum = L::FMul(L::FSet(weights[0]), L::FLoadPixels(base));
+        for(size_t k = 1; k < taps; k++)
+            sum = L::FMulAdd(L::FSet(weights[k]), L::FLoadPixels(base + k * 4), sum);
+        L::FStore(out + i, sum);
+    }
+    for(; i < count; i++) {
+        const float *base = src + (i / 4) * 8 + i % 4;
+        float sum = 0.0f;
+        for(size_t k = 0; k < taps; k++)
+            sum += weights[k] * base[k * 4];
+        out[i] = sum;
+    }
+}
+
+template<typename L>
+inline void EncodeRowWith(const float *src, size_t count, uint8_t *dst) {
+    typename L::FVec scale = L::FSet(255.0f);
+    size_t i = 0;
+    for(; i + L::FloatWidth <= count; i += L::FloatWidth)
+        L::FStoreBytes(dst + i, L::FMul(L::FLoad(src + i), scale));
+    for(; i < count; i++)
+        ScalarPixelLanes::FStoreBytes(dst + i, src[i] * 255.0f);
+}
+
+template<typename L>
+inline void SwizzleWith(const uint8_t *src, size_t pixels, const uint8_t *order, uint8_t *dst) {
+    using Vec = typename L::Vec;
+
+    Vec mask = L::Set32(0xFF);
+    size_t i = 0;
+    for(; i + L::Width <= pixels; i += L::Width) {
+        Vec pixel = L::Load(src + i * 4);
+        Vec result = L::Set32(0);
+        for(int c = 0; c < 4; c++)
+            result = L::Or(result, L::SllVar32(L::And(L::SrlVar32(pixel, order[c] * 8), mask), c * 8));
+        L::Store(dst + i * 4, result);
+    }
+    for(; i < pixels; i++) {
+        uint8_t pixel[4] = {src[i * 4], src[i * 4 + 1], src[i * 4 + 2], src[i * 4 + 3]};
+        for(int c = 0; c < 4; c++)
+            dst[i * 4 + c] = pixel[order[c]];
+    }
+}
+
+template<typename L>
+inline void PremultiplyBlock(const uint8_t *src, uint8_t *dst) {
+    using Vec = typename L::Vec;
+
+    Vec pixel = L::Load(src);
+    Vec alpha = L::template Srl32<24>(pixel);
+    // (R, B) times (A, A), and (G, A) times (A, 255) so alpha stays put.
+    Vec redBlue = L::Mul16(L::And(pixel, L::Set32(0x00FF00FF)), L::Or(alpha, L::template Sll32<16>(alpha)));
+    Vec greenAlpha = L::Mul16(L::template Srl16<8>(pixel), L::Or(alpha, L::Set32(0x00FF0000)));
+    L::Store(dst, L::Or(DivideBy255<L>(redBlue), L::template Sll16<8>(DivideBy255<L>(greenAlpha))));
+}
+
+template<typename L>
+inline void PremultiplyWith(const uint8_t *src, size_t pixels, uint8_t *dst) {
+    size_t i = 0;
+    for(; i + L::Width <= pixels; i += L::Width)
+        PremultiplyBlock<L>(src + i * 4, dst + i * 4);
+    for(; i < pixels; i++)
+        PremultiplyBlock<ScalarPixelLanes>(src + i * 4, dst + i * 4);
+}
+
+// Packs pixels into 5:6:5 with rounding, each channel still in a 32-bit lane.
+template<typename L>
+inline typename L::Vec PackRGB565(typename L::Vec pixel) {
+    using Vec = typename L::Vec;
+
+    Vec byte = L::Set32(0xFF);
+    Vec red = DivideBy255<L>(L::Mul16(L::And(pixel, byte), L::Set32(31)));
+    Vec green = DivideBy255<L>(L::Mul16(L::And(L::template Srl32<8>(pixel), byte), L::Set32(63)));
+    Vec blue = DivideBy255<L>(L::Mul16(L::And(L::template Srl32<16>(pixel), byte), L::Set32(31)));
+    return L::Or(L::Or(L::template Sll32<11>(red), L::template Sll32<5>(green)), blue);
+}
+
+template<typename L>
+inline void ConvertRGB565With(const uint8_t *src, size_t pixels, uint16_t *dst) {
+    size_t i = 0;
+    for(; i + 2 * L::Width <= pixels; i += 2 * L::Width) {
+        typename L::Vec a = PackRGB565<L>(L::Load(src + i * 4));
+        typename L::Vec b = PackRGB565<L>(L::Load(src + (i + L::Width) * 4));
+        L::Store(reinterpret_cast<uint8_t *>(dst + i), L::Narrow32To16(a, b));
+    }
+    for(; i < pixels; i++) {
+        uint32_t packed = PackRGB565<ScalarPixelLanes>(ScalarPixelLanes::Load(src + i * 4));
+        dst[i] = static_cast<uint16_t>(packed);
+    }
+}
+
+template<typename L>
+inline ImageKernels MakeImageKernels(const char *name) {
+    return {DownsampleBoxRowWith<L>, AccumulateRowWith<L>, FilterRowWith<L>, EncodeRowWith<L>,
+            SwizzleWith<L>, PremultiplyWith<L>, ConvertRGB565With<L>, name};
+}
+
+} // namespace
+
+} // namespace VPP
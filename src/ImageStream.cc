@@ -0,0 +1,233 @@
+#include "ImageStream.h"
+#include <cstdlib>
+#include <cstring>
+#include <stb_image.h>
+#include "ImageAllocator.h"
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace VPP {
+
+namespace {
+
+thread_local ImageOutputScope *s_OutputScope = nullptr;
+
+#if defined(_WIN32)
+int OpenForRead(const std::string &path) {
+    return _open(path.c_str(), _O_RDONLY | _O_BINARY);
+}
+int ReadFD(int fd, void *data, size_t size) {
+    return _read(fd, data, static_cast<unsigned int>(size));
+}
+int64_t SeekFD(int fd, int64_t offset, int origin) {
+    return _lseeki64(fd, offset, origin);
+}
+void CloseFD(int fd) {
+    _close(fd);
+}
+#else
+int OpenForRead(const std::string &path) {
+    return open(path.c_str(), O_RDONLY);
+}
+int ReadFD(int fd, void *data, size_t size) {
+    return static_cast<int>(read(fd, data, size));
+}
+int64_t SeekFD(int fd, int64_t offset, int origin) {
+    return lseek(fd, static_cast<off_t>(offset), origin);
+}
+void CloseFD(int fd) {
+    close(fd);
+}
+#endif
+
+// Checks the result of a decode that ran under an ImageOutputScope for
+// `dst` and moves it there if stb allocated its result elsewhere.
+bool FinishDecode(stbi_uc *pixels, int width, int height, uint8_t *dst, ImageInfo &info) {
+    if(!pixels)
+        return false;
+
+    if(static_cast<uint32_t>(width) != info.Width || static_cast<uint32_t>(height) != info.Height) {
+        if(pixels != dst)
+            stbi_image_free(pixels);
+        return false;
+    }
+
+    if(pixels != dst) {
+        std::memcpy(dst, pixels, size_t(info.Width) * info.Height * 4);
+        stbi_image_free(pixels);
+    }
+    return true;
+}
+
+} // namespace
+
+void *ImageMalloc(size_t size) {
+    ImageOutputScope *scope = s_OutputScope;
+    if(scope && !scope->m_InUse && size == scope->m_Size) {
+        scope->m_InUse = true;
+        return scope->m_Buffer;
+    }
+    return std::malloc(size);
+}
+
+void *ImageRealloc(void *pointer, size_t size) {
+    ImageOutputScope *scope = s_OutputScope;
+    if(scope && pointer && pointer == scope->m_Buffer) {
+        // The caller's buffer cannot grow; move the block to the heap.
+        void *moved = std::malloc(size);
+        if(moved)
+            std::memcpy(moved, pointer, size < scope->m_Size ? size : scope->m_Size);
+        scope->m_InUse = false;
+        return moved;
+    }
+    return std::realloc(pointer, size);
+}
+
+void ImageFree(void *pointer) {
+    ImageOutputScope *scope = s_OutputScope;
+    if(scope && pointer && pointer == scope->m_Buffer) {
+        scope->m_InUse = false;
+        return;
+    }
+    std::free(pointer);
+}
+
+ImageOutputScope::ImageOutputScope(uint8_t *buffer, size_t size)
+    : m_Previous(s_OutputScope), m_Buffer(buffer), m_Size(size) {
+    s_OutputScope = this;
+}
+
+ImageOutputScope::~ImageOutputScope() {
+    s_OutputScope = m_Previous;
+}
+
+ImageStream::ImageStream(int fd, size_t chunkSize)
+    : m_FD(fd), m_Chunk(chunkSize > 0 ? chunkSize : DefaultChunkSize) {
+    m_Start = m_FD >= 0 ? SeekFD(m_FD, 0, SEEK_CUR) : 0;
+    m_ChunkOffset = m_Start;
+}
+
+ImageStream::ImageStream(const std::string &path, size_t chunkSize)
+    : ImageStream(OpenForRead(path), chunkSize) {
+    m_OwnsFD = true;
+}
+
+ImageStream::~ImageStream() {
+    if(m_OwnsFD && m_FD >= 0)
+        CloseFD(m_FD);
+}
+
+bool ImageStream::ReadInfo(ImageInfo &info) {
+    if(!IsOpen() || !Seek(m_Start))
+        return false;
+
+    stbi_io_callbacks callbacks = {&ImageStream::ReadCallback, &ImageStream::SkipCallback, &ImageStream::EofCallback};
+    int width, height, channels;
+    if(!stbi_info_from_callbacks(&callbacks, this, &width, &height, &channels))
+        return false;
+
+    info.Width = static_cast<uint32_t>(width);
+    info.Height = static_cast<uint32_t>(height);
+    info.Channels = static_cast<uint32_t>(channels);
+    return true;
+}
+
+bool ImageStream::DecodeRGBA8(uint8_t *dst, size_t capacity, ImageInfo &info) {
+    if(!ReadInfo(info) || size_t(info.Width) * info.Height * 4 > capacity || !Seek(m_Start))
+        return false;
+
+    stbi_io_callbacks callbacks = {&ImageStream::ReadCallback, &ImageStream::SkipCallback, &ImageStream::EofCallback};
+    int width, height, channels;
+    stbi_uc *pixels;
+    {
+        ImageOutputScope scope(dst, size_t(info.Width) * info.Height * 4);
+        pixels = stbi_load_from_callbacks(&callbacks, this, &width, &height, &channels, STBI_rgb_alpha);
+    }
+    return FinishDecode(pixels, width, height, dst, info);
+}
+
+int ImageStream::ReadCallback(void *user, char *data, int size) {
+    auto *stream = static_cast<ImageStream *>(user);
+    int done = 0;
+    while(done < size) {
+        if(stream->m_ChunkPos == stream->m_ChunkEnd && !stream->Fill())
+            break;
+
+        size_t count = stream->m_ChunkEnd - stream->m_ChunkPos;
+        if(count > size_t(size - done))
+            count = size_t(size - done);
+        std::memcpy(data + done, stream->m_Chunk.data() + stream->m_ChunkPos, count);
+        stream->m_ChunkPos += count;
+        done += static_cast<int>(count);
+    }
+    return done;
+}
+
+void ImageStream::SkipCallback(void *user, int count) {
+    auto *stream = static_cast<ImageStream *>(user);
+    int64_t target = stream->m_ChunkOffset + int64_t(stream->m_ChunkPos) + count;
+    if(target >= stream->m_ChunkOffset && target <= stream->m_ChunkOffset + int64_t(stream->m_ChunkEnd))
+        stream->m_ChunkPos = size_t(target - stream->m_ChunkOffset);
+    else
+        stream->Seek(target);
+}
+
+int ImageStream::EofCallback(void *user) {
+    auto *stream = static_cast<ImageStream *>(user);
+    return stream->m_ChunkPos == stream->m_ChunkEnd && !stream->Fill();
+}
+
+bool ImageStream::Fill() {
+    if(m_AtEnd)
+        return false;
+
+    m_ChunkOffset += int64_t(m_ChunkEnd);
+    int count = ReadFD(m_FD, m_Chunk.data(), m_Chunk.size());
+    m_ChunkPos = 0;
+    m_ChunkEnd = count > 0 ? size_t(count) : 0;
+    m_AtEnd = count <= 0;
+    return count > 0;
+}
+
+bool ImageStream::Seek(int64_t position) {
+    m_ChunkOffset = position;
+    m_ChunkPos = 0;
+    m_ChunkEnd = 0;
+    m_AtEnd = false;
+    return SeekFD(m_FD, position, SEEK_SET) == position;
+}
+
+bool DecodeImageRGBA8(const uint8_t *data, size_t size, uint8_t *dst, size_t capacity, ImageInfo &info) {
+    if(!ReadImageInfo(data, size, info) || size_t(info.Width) * info.Height * 4 > capacity)
+        return false;
+
+    int width, height, channels;
+    stbi_uc *pixels;
+    {
+        ImageOutputScope scope(dst, size_t(info.Width) * info.Height * 4);
+        pixels = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, STBI_rgb_alpha);
+    }
+    return FinishDecode(pixels, width, height, dst, info);
+}
+
+bool ReadImageInfo(const uint8_t *data, size_t size, ImageInfo &info) {
+    if(size > static_cast<size_t>(INT32_MAX))
+        return false;
+
+    int width, height, channels;
+    if(!stbi_info_from_memory(data, static_cast<int>(size), &width, &height, &channels))
+        return false;
+
+    info.Width = static_cast<uint32_t>(width);
+    info.Height = static_cast<uint32_t>(height);
+    info.Channels = static_cast<uint32_t>(channels);
+    return true;
+}
+
+} // namespace VPP
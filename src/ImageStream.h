@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace VPP {
+
+struct ImageInfo {
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint32_t Channels = 0;
+};
+
+// Feeds an image file to stb_image through stbi_load_from_callbacks, read
+// from a file descriptor `chunkSize` bytes at a time, so the compressed
+// file is never in memory as a whole. Decoding goes into a buffer the
+// caller provides, e.g. a block of a staging arena: stb's output
+// allocation is redirected into it (see ImageOutputScope), which saves the
+// malloc and the copy of the decoded image.
+//
+// The descriptor must be seekable; reading starts at its offset when the
+// stream is created, and ReadInfo() rewinds to there for the decode.
+class ImageStream {
+public:
+    static constexpr size_t DefaultChunkSize = 64 * 1024;
+
+    // Borrows `fd`; the caller closes it.
+    explicit ImageStream(int fd, size_t chunkSize = DefaultChunkSize);
+    // Opens and owns the file at `path`.
+    explicit ImageStream(const std::string &path, size_t chunkSize = DefaultChunkSize);
+    ~ImageStream();
+
+    ImageStream(const ImageStream &) = delete;
+    ImageStream &operator=(const ImageStream &) = delete;
+
+    bool IsOpen() const {
+        return m_FD >= 0;
+    }
+
+    // Parses only the header.
+    bool ReadInfo(ImageInfo &info);
+
+    // Decodes the image as RGBA8 into `dst`, which must hold at least
+    // width * height * 4 bytes; fails without writing if it does not.
+    bool DecodeRGBA8(uint8_t *dst, size_t capacity, ImageInfo &info);
+
+private:
+    static int ReadCallback(void *user, char *data, int size);
+    static void SkipCallback(void *user, int count);
+    static int EofCallback(void *user);
+
+    bool Fill();
+    bool Seek(int64_t position);
+
+private:
+    int m_FD = -1;
+    bool m_OwnsFD = false;
+    int64_t m_Start = 0;
+
+    // m_Chunk[m_ChunkPos, m_ChunkEnd) holds the file from m_ChunkOffset +
+    // m_ChunkPos on.
+    std::vector<uint8_t> m_Chunk;
+    size_t m_ChunkPos = 0;
+    size_t m_ChunkEnd = 0;
+    int64_t m_ChunkOffset = 0;
+    bool m_AtEnd = false;
+};
+
+// In-memory counterpart of ImageStream::DecodeRGBA8.
+bool DecodeImageRGBA8(const uint8_t *data, size_t size, uint8_t *dst, size_t capacity, ImageInfo &info);
+
+// Header of an in-memory image file.
+bool ReadImageInfo(const uint8_t *data, size_t size, ImageInfo &info);
+
+} // namespace VPP
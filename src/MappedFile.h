@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace VPP {
+
+// Read-only memory mapping of a whole file. The mapping lives until Close()
+// or destruction; pointers into GetData() must not outlive it.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    bool Open(const std::string &path);
+    void Close();
+
+    bool IsOpen() const {
+        return m_Data != nullptr;
+    }
+    const uint8_t *GetData() const {
+        return m_Data;
+    }
+    size_t GetSize() const {
+        return m_Size;
+    }
+
+private:
+    const uint8_t *m_Data = nullptr;
+    size_t m_Size = 0;
+#if defined(_WIN32)
+    void *m_File = nullptr;
+    void *m_Mapping = nullptr;
+#endif
+};
+
+} // namespace VPP
@@ -0,0 +1,19 @@
+#include "PackedTransform.h"
+#include "GameObject.h"
+
+namespace VPP {
+
+PackedTransform::PackedTransform(const Transform &transform)
+    : Translation(transform.Translation), Rotation(glm::quat(transform.Rotation)), Scale(transform.Scale) {
+}
+
+glm::mat4 PackedTransform::GetTransform() const {
+    glm::mat4 transform = glm::toMat4(Rotation);
+    transform[0] *= Scale.x;
+    transform[1] *= Scale.y;
+    transform[2] *= Scale.z;
+    transform[3] = glm::vec4(Translation, 1.0f);
+    return transform;
+}
+
+} // namespace VPP
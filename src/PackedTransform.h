@@ -0,0 +1,340 @@
+#pragma once
+
+#include <iterator>
+#include <tuple>
+#include <vector>
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include "AlignedAllocator.h"
+#include "Registry.h"
+
+namespace VPP {
+
+struct Transform;
+
+// Opt-in structure-of-arrays alternative to Transform. Its pool keeps
+// translations, rotations (as quaternions, so no Euler conversion is needed)
+// and scales in three separate 64-byte aligned arrays; a system that only
+// moves objects streams 12 bytes per entity instead of a whole Transform.
+struct PackedTransform {
+    glm::vec3 Translation = {0.0f, 0.0f, 0.0f};
+    glm::quat Rotation = {1.0f, 0.0f, 0.0f, 0.0f};
+    glm::vec3 Scale = {1.0f, 1.0f, 1.0f};
+
+    PackedTransform() = default;
+    PackedTransform(const PackedTransform &) = default;
+    PackedTransform(const glm::vec3 &translation)
+        : Translation(translation) {}
+    explicit PackedTransform(const Transform &transform);
+
+    glm::mat4 GetTransform() const;
+};
+
+// What the pool hands out in place of a PackedTransform &: references into
+// the three arrays. Assigning a PackedTransform writes all of them.
+struct PackedTransformRef {
+    glm::vec3 &Translation;
+    glm::quat &Rotation;
+    glm::vec3 &Scale;
+
+    PackedTransformRef &operator=(const PackedTransform &value) {
+        Translation = value.Translation;
+        Rotation = value.Rotation;
+        Scale = value.Scale;
+        return *this;
+    }
+
+    operator PackedTransform() const {
+        PackedTransform value;
+        value.Translation = Translation;
+        value.Rotation = Rotation;
+        value.Scale = Scale;
+        return value;
+    }
+
+    glm::mat4 GetTransform() const {
+        return PackedTransform(*this).GetTransform();
+    }
+};
+
+// EnTT storage for PackedTransform, selected through the storage_type
+// specialization below. Arrays are indexed like the packed entity array:
+// the streams at position index(entity) belong to `entity`. The streams
+// allocate from the same memory resource as the rest of the registry.
+class PackedTransformStorage: public entt::basic_sparse_set<entt::entity, RegistryAllocator> {
+    using vec3_container = std::vector<glm::vec3, AlignedAllocator<glm::vec3>>;
+    using quat_container = std::vector<glm::quat, AlignedAllocator<glm::quat>>;
+
+    template<typename Storage, typename Value>
+    class basic_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = Value;
+        using pointer = void;
+        using reference = Value;
+
+        basic_iterator() = default;
+        basic_iterator(Storage *storage, difference_type offset)
+            : m_Storage(storage), m_Offset(offset) {}
+
+        basic_iterator &operator++() {
+            --m_Offset;
+            return *this;
+        }
+        basic_iterator operator++(int) {
+            basic_iterator other = *this;
+            ++(*this);
+            return other;
+        }
+
+        reference operator*() const {
+            return m_Storage->GetAt(static_cast<size_t>(m_Offset - 1));
+        }
+
+        bool operator==(const basic_iterator &other) const {
+            return m_Offset == other.m_Offset;
+        }
+        bool operator!=(const basic_iterator &other) const {
+            return !(*this == other);
+        }
+
+    private:
+        Storage *m_Storage = nullptr;
+        difference_type m_Offset = 0;
+    };
+
+    template<typename Storage, typename Value, typename Base>
+    class basic_each_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = std::tuple<entt::entity, Value>;
+        using pointer = void;
+        using reference = value_type;
+
+        basic_each_iterator() = default;
+        basic_each_iterator(Storage *storage, Base base)
+            : m_Storage(storage), m_Base(base) {}
+
+        basic_each_iterator &operator++() {
+            ++m_Base;
+            return *this;
+        }
+        basic_each_iterator operator++(int) {
+            basic_each_iterator other = *this;
+            ++(*this);
+            return other;
+        }
+
+        reference operator*() const {
+            return {*m_Base, m_Storage->GetAt(static_cast<size_t>(m_Base.index()))};
+        }
+
+        Base base() const {
+            return m_Base;
+        }
+
+        bool operator==(const basic_each_iterator &other) const {
+            return m_Base == other.m_Base;
+        }
+        bool operator!=(const basic_each_iterator &other) const {
+            return !(*this == other);
+        }
+
+    private:
+        Storage *m_Storage = nullptr;
+        Base m_Base;
+    };
+
+public:
+    using base_type = entt::basic_sparse_set<entt::entity, RegistryAllocator>;
+    using value_type = PackedTransform;
+    using traits_type = entt::component_traits<value_type>;
+    using entity_type = entt::entity;
+    using size_type = std::size_t;
+    using allocator_type = ResourceAllocator<PackedTransform>;
+    using iterator = basic_iterator<PackedTransformStorage, PackedTransformRef>;
+    using const_iterator = basic_iterator<const PackedTransformStorage, PackedTransform>;
+    using iterable = entt::iterable_adaptor<basic_each_iterator<PackedTransformStorage, PackedTransformRef, base_type::iterator>>;
+    using const_iterable = entt::iterable_adaptor<basic_each_iterator<const PackedTransformStorage, PackedTransform, base_type::const_iterator>>;
+
+    PackedTransformStorage()
+        : PackedTransformStorage(allocator_type{}) {}
+    explicit PackedTransformStorage(const allocator_type &allocator)
+        : base_type(entt::type_id<PackedTransform>(), entt::deletion_policy::swap_and_pop, allocator),
+          m_Translations(allocator.GetResource()),
+          m_Rotations(allocator.GetResource()),
+          m_Scales(allocator.GetResource()) {}
+
+    PackedTransformStorage(PackedTransformStorage &&) = default;
+    PackedTransformStorage &operator=(PackedTransformStorage &&) = default;
+
+    allocator_type get_allocator() const noexcept {
+        return allocator_type{m_Translations.get_allocator().GetResource()};
+    }
+
+    void reserve(const size_type cap) override {
+        base_type::reserve(cap);
+        m_Translations.reserve(cap);
+        m_Rotations.reserve(cap);
+        m_Scales.reserve(cap);
+    }
+
+    void shrink_to_fit() override {
+        base_type::shrink_to_fit();
+        m_Translations.shrink_to_fit();
+        m_Rotations.shrink_to_fit();
+        m_Scales.shrink_to_fit();
+    }
+
+    // Streams in packed order, one entry per entity in data().
+    glm::vec3 *Translations() noexcept {
+        return m_Translations.data();
+    }
+    const glm::vec3 *Translations() const noexcept {
+        return m_Translations.data();
+    }
+    glm::quat *Rotations() noexcept {
+        return m_Rotations.data();
+    }
+    const glm::quat *Rotations() const noexcept {
+        return m_Rotations.data();
+    }
+    glm::vec3 *Scales() noexcept {
+        return m_Scales.data();
+    }
+    const glm::vec3 *Scales() const noexcept {
+        return m_Scales.data();
+    }
+
+    PackedTransformRef GetAt(size_type pos) noexcept {
+        return {m_Translations[pos], m_Rotations[pos], m_Scales[pos]};
+    }
+    PackedTransform GetAt(size_type pos) const noexcept {
+        PackedTransform value;
+        value.Translation = m_Translations[pos];
+        value.Rotation = m_Rotations[pos];
+        value.Scale = m_Scales[pos];
+        return value;
+    }
+
+    PackedTransformRef get(const entity_type entt) noexcept {
+        return GetAt(index(entt));
+    }
+    PackedTransform get(const entity_type entt) const noexcept {
+        return GetAt(index(entt));
+    }
+
+    std::tuple<PackedTransformRef> get_as_tuple(const entity_type entt) noexcept {
+        return std::make_tuple(get(entt));
+    }
+    std::tuple<PackedTransform> get_as_tuple(const entity_type entt) const noexcept {
+        return std::make_tuple(get(entt));
+    }
+
+    template<typename... Args>
+    PackedTransformRef emplace(const entity_type entt, Args &&...args) {
+        const auto it = base_type::try_emplace(entt, true);
+        PushBack(PackedTransform{std::forward<Args>(args)...});
+        return GetAt(static_cast<size_type>(it.index()));
+    }
+
+    template<typename... Func>
+    PackedTransformRef patch(const entity_type entt, Func &&...func) {
+        PackedTransformRef ref = get(entt);
+        (std::forward<Func>(func)(ref), ...);
+        return ref;
+    }
+
+    template<typename It>
+    void insert(It first, It last, const value_type &value = {}) {
+        for(; first != last; ++first) {
+            base_type::try_emplace(*first, true);
+            PushBack(value);
+        }
+    }
+
+    template<typename EIt, typename CIt, typename = std::enable_if_t<std::is_same_v<typename std::iterator_traits<CIt>::value_type, value_type>>>
+    void insert(EIt first, EIt last, CIt from) {
+        for(; first != last; ++first, ++from) {
+            base_type::try_emplace(*first, true);
+            PushBack(*from);
+        }
+    }
+
+    iterator begin() noexcept {
+        return {this, static_cast<std::ptrdiff_t>(size())};
+    }
+    iterator end() noexcept {
+        return {this, 0};
+    }
+    const_iterator begin() const noexcept {
+        return {this, static_cast<std::ptrdiff_t>(size())};
+    }
+    const_iterator end() const noexcept {
+        return {this, 0};
+    }
+
+    iterable each() noexcept {
+        return {{this, base_type::begin()}, {this, base_type::end()}};
+    }
+    const_iterable each() const noexcept {
+        return {{this, base_type::cbegin()}, {this, base_type::cend()}};
+    }
+
+protected:
+    void pop(base_type::basic_iterator first, base_type::basic_iterator last) override {
+        for(; first != last; ++first) {
+            size_type pos = index(*first);
+            size_type back = size() - 1u;
+            m_Translations[pos] = m_Translations[back];
+            m_Rotations[pos] = m_Rotations[back];
+            m_Scales[pos] = m_Scales[back];
+            m_Translations.pop_back();
+            m_Rotations.pop_back();
+            m_Scales.pop_back();
+            base_type::swap_and_pop(first);
+        }
+    }
+
+    void pop_all() override {
+        m_Translations.clear();
+        m_Rotations.clear();
+        m_Scales.clear();
+        base_type::pop_all();
+    }
+
+    base_type::basic_iterator try_emplace(const entity_type entt, const bool, const void *value) override {
+        // Streams only grow at the back, so neither may the entity array.
+        const auto it = base_type::try_emplace(entt, true);
+        PushBack(value ? *static_cast<const value_type *>(value) : value_type{});
+        return it;
+    }
+
+private:
+    void swap_or_move(const std::size_t from, const std::size_t to) override {
+        std::swap(m_Translations[from], m_Translations[to]);
+        std::swap(m_Rotations[from], m_Rotations[to]);
+        std::swap(m_Scales[from], m_Scales[to]);
+    }
+
+    void PushBack(const PackedTransform &value) {
+        m_Translations.push_back(value.Translation);
+        m_Rotations.push_back(value.Rotation);
+        m_Scales.push_back(value.Scale);
+    }
+
+private:
+    vec3_container m_Translations;
+    quat_container m_Rotations;
+    vec3_container m_Scales;
+};
+
+} // namespace VPP
+
+template<>
+struct entt::storage_type<VPP::PackedTransform, entt::entity, VPP::ResourceAllocator<VPP::PackedTransform>> {
+    using type = entt::sigh_mixin<VPP::PackedTransformStorage>;
+};
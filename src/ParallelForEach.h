@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+#include <utility>
+#include <entt/entt.hpp>
+#include "ThreadPool.h"
+
+namespace VPP {
+
+constexpr size_t DefaultParallelGrainSize = 1024;
+
+// Smallest chunk alignment that keeps every chunk on whole pages of each of
+// the given pools, which hold their components in pages of page_size
+// elements. Pools without per-entity data do not constrain it.
+template<typename... Storage>
+constexpr size_t GetParallelChunkAlignment() {
+    size_t alignment = 1;
+    ((alignment = std::lcm(alignment, std::max<size_t>(entt::component_traits<typename Storage::value_type>::page_size, 1))), ...);
+    return alignment;
+}
+
+// Splits `count` items starting at the random access iterator `first` into
+// chunks of `grainSize` and runs them on `pool`. The grain is rounded up to
+// a multiple of `alignment`, so every chunk but the last starts and ends on
+// an index that is a multiple of it. The split only depends on `count`,
+// `grainSize` and `alignment`, never on the number of threads, so the same
+// items always end up in the same chunk.
+template<typename It, typename Visit>
+void ParallelForEachChunk(ThreadPool &pool, It first, size_t count, size_t grainSize, Visit visit, size_t alignment = 1) {
+    if(count == 0)
+        return;
+
+    size_t grain = grainSize < alignment ? alignment : grainSize;
+    grain = (grain + alignment - 1) / alignment * alignment;
+
+    if(count <= grain) {
+        for(size_t i = 0; i < count; i++) visit(first[i]);
+        return;
+    }
+
+    TaskGroup group;
+    for(size_t begin = 0; begin < count; begin += grain) {
+        size_t end = begin + grain < count ? begin + grain : count;
+        pool.Submit(group, [first, begin, end, &visit] {
+            for(size_t i = begin; i < end; i++) visit(first[i]);
+        });
+    }
+    pool.Wait(group);
+}
+
+// Calls func(entity, components...) for every entity of `view` from the
+// threads of `pool`. The callback may only touch the entity it is given.
+// Chunks walk the view's leading pool front to back and cover whole pages
+// of it. The view's other pools hold the same entities in their own order,
+// so writes to them from different chunks may still share cache lines.
+template<typename... Get, typename... Exclude, typename Func>
+void ParallelForEach(ThreadPool &pool, const entt::basic_view<entt::get_t<Get...>, entt::exclude_t<Exclude...>> &view,
+                     Func func, size_t grainSize = DefaultParallelGrainSize) {
+    const auto *leading = view.handle();
+    if(!leading)
+        return;
+
+    constexpr size_t alignment = GetParallelChunkAlignment<Get...>();
+    ParallelForEachChunk(pool, leading->rbegin(), leading->size(), grainSize, [&view, &func](entt::entity entity) {
+        if(view.contains(entity))
+            std::apply(func, std::tuple_cat(std::make_tuple(entity), view.get(entity)));
+    }, alignment);
+}
+
+// Same for groups; every entity in the group's range is a member, so no
+// per-entity membership test is needed. Owned pools keep the group's
+// entities at their front in group order, so chunks cover whole pages of
+// every owned pool and no two chunks write to the same page of one.
+template<typename... Owned, typename... Get, typename... Exclude, typename Func>
+void ParallelForEach(ThreadPool &pool, const entt::basic_group<entt::owned_t<Owned...>, entt::get_t<Get...>, entt::exclude_t<Exclude...>> &group,
+                     Func func, size_t grainSize = DefaultParallelGrainSize) {
+    if(!group)
+        return;
+
+    constexpr size_t alignment = GetParallelChunkAlignment<Owned...>();
+    ParallelForEachChunk(pool, group.rbegin(), group.size(), grainSize, [&group, &func](entt::entity entity) {
+        std::apply(func, std::tuple_cat(std::make_tuple(entity), group.get(entity)));
+    }, alignment);
+}
+
+} // namespace VPP
@@ -0,0 +1,263 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define VPP_PROFILER_TSC 1
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define VPP_PROFILER_TSC 1
+#endif
+
+namespace VPP {
+
+namespace {
+
+int64_t GetSteadyNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void WriteJsonString(std::FILE *file, const char *text) {
+    std::fputc('"', file);
+    for(const char *c = text; *c; c++) {
+        if(*c == '"' || *c == '\\')
+            std::fprintf(file, "\\%c", *c);
+        else if(static_cast<unsigned char>(*c) < 0x20)
+            std::fprintf(file, "\\u%04x", static_cast<unsigned>(*c));
+        else
+            std::fputc(*c, file);
+    }
+    std::fputc('"', file);
+}
+
+} // namespace
+
+// What the profiler knows about the calling thread. Its buffer outlives
+// the thread until the collector has drained it.
+struct Profiler::ThreadState {
+    ThreadBuffer *Buffer = nullptr;
+    uint32_t Depth = 0;
+    std::string Name;
+
+    ~ThreadState() {
+        if(Buffer)
+            Buffer->Retired.store(true, std::memory_order_release);
+    }
+};
+
+std::atomic<bool> Profiler::s_Enabled{false};
+thread_local Profiler::ThreadState Profiler::s_Thread;
+
+Profiler::Profiler() {
+    m_BaseTicks = Now();
+    m_BaseNanoseconds = GetSteadyNanoseconds();
+    m_FrameStart = m_BaseNanoseconds;
+
+#if defined(VPP_PROFILER_TSC)
+    // A first estimate of the TSC rate, good enough for the first frames.
+    while(GetSteadyNanoseconds() - m_BaseNanoseconds < 2000000) {}
+    Calibrate();
+#endif
+}
+
+Profiler &Profiler::Get() {
+    // Never destroyed: threads may still finish zones during static
+    // destruction (e.g. the default ThreadPool's workers).
+    static Profiler *s_Profiler = new Profiler();
+    return *s_Profiler;
+}
+
+void Profiler::SetEnabled(bool enabled) {
+    s_Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const std::string &name) {
+    s_Thread.Name = name;
+    if(s_Thread.Buffer) {
+        Profiler &profiler = Get();
+        std::lock_guard<std::mutex> lock(profiler.m_Mutex);
+        profiler.m_ThreadNames[s_Thread.Buffer->ThreadID - 1] = name;
+    }
+}
+
+void Profiler::EndFrame() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Calibrate();
+    Drain();
+
+    int64_t now = GetSteadyNanoseconds();
+    ProfileFrameStats frame;
+    frame.Index = m_FrameIndex++;
+    frame.DurationMs = double(now - m_FrameStart) * 1e-6;
+    frame.DroppedZones = m_Dropped;
+    frame.Zones = std::move(m_Zones);
+    std::sort(frame.Zones.begin(), frame.Zones.end(), [](const ProfileZoneStats &a, const ProfileZoneStats &b) {
+        return a.TotalMs > b.TotalMs;
+    });
+
+    m_FrameStart = now;
+    m_Dropped = 0;
+    m_Zones.clear();
+    m_ZoneIndex.clear();
+    m_LastFrame = std::move(frame);
+}
+
+ProfileFrameStats Profiler::GetLastFrame() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_LastFrame;
+}
+
+void Profiler::BeginCapture(size_t maxZones) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Captured.clear();
+    m_CaptureLimit = maxZones;
+    m_Capturing = true;
+}
+
+void Profiler::EndCapture() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Drain();
+    m_Capturing = false;
+}
+
+bool Profiler::IsCapturing() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Capturing;
+}
+
+bool Profiler::WriteChromeTrace(const std::string &path) const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if(!file)
+        return false;
+
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+    bool first = true;
+    for(size_t i = 0; i < m_ThreadNames.size(); i++) {
+        std::fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":", first ? "" : ",", i + 1);
+        WriteJsonString(file, m_ThreadNames[i].c_str());
+        std::fputs("}}", file);
+        first = false;
+    }
+    for(const CapturedZone &zone: m_Captured) {
+        std::fprintf(file, "%s\n{\"name\":", first ? "" : ",");
+        WriteJsonString(file, zone.Name);
+        std::fprintf(file, ",\"cat\":\"vpp\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", zone.ThreadID,
+                     ToMicroseconds(zone.Begin), ToMilliseconds(zone.End - zone.Begin) * 1e3);
+        first = false;
+    }
+    std::fputs("\n]}\n", file);
+
+    bool written = !std::ferror(file);
+    return std::fclose(file) == 0 && written;
+}
+
+uint64_t Profiler::Now() {
+#if defined(VPP_PROFILER_TSC)
+    return __rdtsc();
+#else
+    return uint64_t(GetSteadyNanoseconds());
+#endif
+}
+
+void Profiler::ThreadBuffer::Push(const Zone &zone) {
+    uint64_t head = Head.load(std::memory_order_relaxed);
+    if(head - Tail.load(std::memory_order_acquire) >= ThreadBufferZones) {
+        Dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Zones[head & (ThreadBufferZones - 1)] = zone;
+    Head.store(head + 1, std::memory_order_release);
+}
+
+Profiler::ThreadBuffer &Profiler::GetThreadBuffer() {
+    if(!s_Thread.Buffer) {
+        auto buffer = std::make_unique<ThreadBuffer>();
+        buffer->Zones = std::make_unique<Zone[]>(ThreadBufferZones);
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_ThreadNames.push_back(s_Thread.Name.empty() ? "Thread " + std::to_string(m_ThreadNames.size() + 1) : s_Thread.Name);
+        buffer->ThreadID = uint32_t(m_ThreadNames.size());
+        s_Thread.Buffer = buffer.get();
+        m_Buffers.push_back(std::move(buffer));
+    }
+    return *s_Thread.Buffer;
+}
+
+void Profiler::Drain() {
+    static_assert((ThreadBufferZones & (ThreadBufferZones - 1)) == 0, "ThreadBufferZones must be a power of two");
+
+    for(auto it = m_Buffers.begin(); it != m_Buffers.end();) {
+        ThreadBuffer &buffer = **it;
+        // Checked first: once retired, Head no longer moves.
+        bool retired = buffer.Retired.load(std::memory_order_acquire);
+        uint64_t head = buffer.Head.load(std::memory_order_acquire);
+
+        for(uint64_t tail = buffer.Tail.load(std::memory_order_relaxed); tail < head; tail++) {
+            const Zone &zone = buffer.Zones[tail & (ThreadBufferZones - 1)];
+
+            // A zone is recorded when it ends, so its nested zones were all
+            // recorded before it, one level deeper.
+            double ms = ToMilliseconds(zone.End - zone.Begin);
+            if(buffer.ChildMs.size() < size_t(zone.Depth) + 2)
+                buffer.ChildMs.resize(size_t(zone.Depth) + 2, 0.0);
+            double selfMs = ms - buffer.ChildMs[zone.Depth + 1];
+            buffer.ChildMs[zone.Depth + 1] = 0.0;
+            buffer.ChildMs[zone.Depth] += ms;
+
+            auto [found, inserted] = m_ZoneIndex.try_emplace(zone.Name, m_Zones.size());
+            if(inserted) {
+                m_Zones.emplace_back();
+                m_Zones.back().Name = zone.Name;
+            }
+            ProfileZoneStats &stats = m_Zones[found->second];
+            stats.Calls++;
+            stats.TotalMs += ms;
+            stats.SelfMs += selfMs;
+            stats.MaxMs = std::max(stats.MaxMs, ms);
+
+            if(m_Capturing && m_Captured.size() < m_CaptureLimit)
+                m_Captured.push_back({zone.Name, zone.Begin, zone.End, buffer.ThreadID});
+        }
+        buffer.Tail.store(head, std::memory_order_release);
+        m_Dropped += buffer.Dropped.exchange(0, std::memory_order_relaxed);
+
+        if(retired)
+            it = m_Buffers.erase(it);
+        else
+            ++it;
+    }
+}
+
+double Profiler::ToMilliseconds(uint64_t ticks) const {
+    return double(ticks) * m_NanosecondsPerTick * 1e-6;
+}
+
+double Profiler::ToMicroseconds(uint64_t ticks) const {
+    return double(int64_t(ticks - m_BaseTicks)) * m_NanosecondsPerTick * 1e-3;
+}
+
+void Profiler::Calibrate() {
+#if defined(VPP_PROFILER_TSC)
+    uint64_t ticks = Now();
+    int64_t nanoseconds = GetSteadyNanoseconds();
+    if(ticks > m_BaseTicks && nanoseconds > m_BaseNanoseconds)
+        m_NanosecondsPerTick = double(nanoseconds - m_BaseNanoseconds) / double(ticks - m_BaseTicks);
+#endif
+}
+
+void ProfileScope::Begin(const char *name) {
+    m_Name = name;
+    m_Depth = Profiler::s_Thread.Depth++;
+    m_Begin = Profiler::Now();
+}
+
+void ProfileScope::End() {
+    uint64_t end = Profiler::Now();
+    Profiler::s_Thread.Depth--;
+    Profiler::Get().GetThreadBuffer().Push({m_Name, m_Begin, end, m_Depth});
+}
+
+} // namespace VPP
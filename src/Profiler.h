@@ -0,0 +1,179 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace VPP {
+
+// Time spent in one zone name during a frame, summed over all threads.
+struct ProfileZoneStats {
+    const char *Name = nullptr;
+    uint32_t Calls = 0;
+    // Inclusive of nested zones, and without them (same thread only).
+    double TotalMs = 0.0;
+    double SelfMs = 0.0;
+    double MaxMs = 0.0;
+};
+
+struct ProfileFrameStats {
+    uint64_t Index = 0;
+    // Wall time since the previous EndFrame().
+    double DurationMs = 0.0;
+    // Zones lost because a thread's buffer was full.
+    uint64_t DroppedZones = 0;
+    // Largest TotalMs first.
+    std::vector<ProfileZoneStats> Zones;
+};
+
+// Collects the zones VPP_PROFILE_SCOPE records. Every thread writes its
+// zones to its own fixed-size ring buffer without locking; EndFrame()
+// drains all of them, once per frame, into the frame's statistics and,
+// while capturing, into a trace that WriteChromeTrace() exports in the
+// Chrome trace_event format (opens in Perfetto and chrome://tracing).
+//
+// Zones are only recorded while the profiler is enabled, which it is not
+// by default; a disabled VPP_PROFILE_SCOPE costs one relaxed load. Built
+// with VPP_ENABLE_PROFILER off (CMake option), the macros expand to
+// nothing.
+class Profiler {
+public:
+    static constexpr size_t ThreadBufferZones = 8192;
+    static constexpr size_t DefaultCaptureZones = 1 << 20;
+
+    static Profiler &Get();
+
+    static bool IsEnabled() {
+        return s_Enabled.load(std::memory_order_relaxed);
+    }
+    void SetEnabled(bool enabled);
+
+    // Names the calling thread in exported traces.
+    static void SetThreadName(const std::string &name);
+
+    // Collects the zones finished since the last call as one frame.
+    void EndFrame();
+    ProfileFrameStats GetLastFrame() const;
+
+    // Keeps the zones collected from now on (at most `maxZones`) for
+    // WriteChromeTrace(). Starting a capture drops the previous one.
+    void BeginCapture(size_t maxZones = DefaultCaptureZones);
+    void EndCapture();
+    bool IsCapturing() const;
+    bool WriteChromeTrace(const std::string &path) const;
+
+    // Timestamp in the profiler's ticks: the TSC on x86, nanoseconds of
+    // steady_clock elsewhere.
+    static uint64_t Now();
+
+private:
+    struct Zone {
+        const char *Name;
+        uint64_t Begin;
+        uint64_t End;
+        uint32_t Depth;
+    };
+
+    // Single producer (the owning thread), single consumer (the collector).
+    struct ThreadBuffer {
+        std::unique_ptr<Zone[]> Zones;
+        std::atomic<uint64_t> Head{0};
+        std::atomic<uint64_t> Tail{0};
+        std::atomic<uint64_t> Dropped{0};
+        std::atomic<bool> Retired{false};
+        uint32_t ThreadID = 0;
+        // Collector only: time in finished zones per nesting depth whose
+        // parent zone has not been drained yet.
+        std::vector<double> ChildMs;
+
+        void Push(const Zone &zone);
+    };
+
+    struct ThreadState;
+
+    struct CapturedZone {
+        const char *Name;
+        uint64_t Begin;
+        uint64_t End;
+        uint32_t ThreadID;
+    };
+
+    Profiler();
+
+    ThreadBuffer &GetThreadBuffer();
+    void Drain();
+    double ToMilliseconds(uint64_t ticks) const;
+    double ToMicroseconds(uint64_t ticks) const;
+    void Calibrate();
+
+private:
+    static std::atomic<bool> s_Enabled;
+    static thread_local ThreadState s_Thread;
+
+    mutable std::mutex m_Mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_Buffers;
+    std::vector<std::string> m_ThreadNames;
+
+    // Tick to time conversion, refined on every EndFrame().
+    uint64_t m_BaseTicks = 0;
+    int64_t m_BaseNanoseconds = 0;
+    double m_NanosecondsPerTick = 1.0;
+
+    // The frame being collected.
+    std::unordered_map<std::string_view, size_t> m_ZoneIndex;
+    std::vector<ProfileZoneStats> m_Zones;
+    uint64_t m_Dropped = 0;
+    uint64_t m_FrameIndex = 0;
+    int64_t m_FrameStart = 0;
+    ProfileFrameStats m_LastFrame;
+
+    bool m_Capturing = false;
+    size_t m_CaptureLimit = 0;
+    std::vector<CapturedZone> m_Captured;
+
+    friend class ProfileScope;
+};
+
+// Records the time from its construction to its destruction as a zone.
+// `name` must outlive the profiler's use of it; string literals do.
+class ProfileScope {
+public:
+    explicit ProfileScope(const char *name) {
+        if(Profiler::IsEnabled())
+            Begin(name);
+    }
+    ~ProfileScope() {
+        if(m_Name)
+            End();
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    void Begin(const char *name);
+    void End();
+
+private:
+    const char *m_Name = nullptr;
+    uint64_t m_Begin = 0;
+    uint32_t m_Depth = 0;
+};
+
+} // namespace VPP
+
+#define VPP_PROFILE_CONCAT_INNER(a, b) a##b
+#define VPP_PROFILE_CONCAT(a, b) VPP_PROFILE_CONCAT_INNER(a, b)
+
+#if defined(VPP_ENABLE_PROFILER)
+#define VPP_PROFILE_SCOPE(name) ::VPP::ProfileScope VPP_PROFILE_CONCAT(vppProfileScope, __LINE__)(name)
+#define VPP_PROFILE_FUNCTION() VPP_PROFILE_SCOPE(__func__)
+#else
+#define VPP_PROFILE_SCOPE(name) ((void)0)
+#define VPP_PROFILE_FUNCTION() ((void)0)
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <entt/entt.hpp>
+
+namespace VPP {
+
+// Allocator that takes its blocks from a std::pmr::memory_resource. Unlike
+// std::pmr::polymorphic_allocator it has no construct(): entt hands pools
+// their allocator explicitly, and uses-allocator construction would pass
+// it a second time.
+template<typename T>
+class ResourceAllocator {
+public:
+    using value_type = T;
+
+    ResourceAllocator() = default;
+    ResourceAllocator(std::pmr::memory_resource *resource) noexcept
+        : m_Resource(resource) {}
+    template<typename U>
+    ResourceAllocator(const ResourceAllocator<U> &other) noexcept
+        : m_Resource(other.GetResource()) {}
+
+    T *allocate(size_t count) {
+        return static_cast<T *>(m_Resource->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *pointer, size_t count) noexcept {
+        m_Resource->deallocate(pointer, count * sizeof(T), alignof(T));
+    }
+
+    std::pmr::memory_resource *GetResource() const noexcept {
+        return m_Resource;
+    }
+
+    template<typename U>
+    bool operator==(const ResourceAllocator<U> &other) const noexcept {
+        return *m_Resource == *other.GetResource();
+    }
+    template<typename U>
+    bool operator!=(const ResourceAllocator<U> &other) const noexcept {
+        return !(*this == other);
+    }
+
+private:
+    std::pmr::memory_resource *m_Resource = std::pmr::new_delete_resource();
+};
+
+// The registry type every Scene uses. Pools, sparse arrays and signal
+// handlers allocate through the scene's memory resource, so each scene
+// decides where its component memory comes from (see SceneMemory).
+using RegistryAllocator = ResourceAllocator<entt::entity>;
+using Registry = entt::basic_registry<entt::entity, RegistryAllocator>;
+// Type-erased base of every pool in a Registry.
+using RegistrySparseSet = entt::basic_sparse_set<entt::entity, RegistryAllocator>;
+
+// The entt aliases (entt::organizer, entt::snapshot, ...) are bound to
+// entt::registry; these are their counterparts for Registry.
+using Organizer = entt::basic_organizer<Registry>;
+using RegistrySnapshot = entt::basic_snapshot<Registry>;
+using RegistrySnapshotLoader = entt::basic_snapshot_loader<Registry>;
+using RegistryContinuousLoader = entt::basic_continuous_loader<Registry>;
+
+// Default pool of Type in a Registry, without the signal mixin.
+template<typename Type>
+using RegistryStorage = entt::basic_storage<Type, entt::entity, ResourceAllocator<Type>>;
+
+// View over a Registry, e.g. the parameter of a system:
+//     void Move(View<Transform, const Velocity> view);
+template<typename... Get>
+using View = entt::basic_view<entt::get_t<Registry::storage_for_type<Get>...>, entt::exclude_t<>>;
+
+} // namespace VPP
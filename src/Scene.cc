@@ -1,11 +1,98 @@
 #include "Scene.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "GameObject.h"
+#include "Profiler.h"
+#include "Texture.h"
+#include "TransformBatch.h"
 
 namespace VPP {
 
-Scene::Scene() {
+namespace {
+
+template<typename... Component>
+void RegisterComponents(ComponentGroup<Component...>, Scene &scene) {
+    (scene.RegisterComponent<Component>(), ...);
+}
+
+// Ids for Scene::m_Id; 0 is never used, so a zeroed cache matches nothing.
+std::atomic<uint64_t> s_NextSceneId{1};
+
+std::atomic<size_t> s_NextComponentIndex{0};
+
+// Objects created without a name are called "Empty".
+InternedString MakeTag(const std::string &name) {
+    static const InternedString s_EmptyTag("Empty");
+    return name.empty() ? s_EmptyTag : InternedString(name);
+}
+
+} // namespace
+
+// The SoA pool is copied array by array.
+template<>
+void Scene::ClonePool<PackedTransform>(const Registry &source, Registry &target) {
+    const auto *from = source.storage<PackedTransform>();
+    if(!from || from->empty())
+        return;
+
+    const entt::entity *entities = from->data();
+    size_t count = from->size();
+    auto &to = static_cast<PackedTransformStorage &>(target.storage<PackedTransform>());
+    to.insert(entities, entities + count);
+    std::copy_n(from->Translations(), count, to.Translations());
+    std::copy_n(from->Rotations(), count, to.Rotations());
+    std::copy_n(from->Scales(), count, to.Scales());
+}
+
+Scene::Scene()
+    : Scene(SceneMemory::Heap, nullptr) {}
+
+Scene::Scene(SceneMemory memory)
+    : Scene(memory, nullptr) {}
+
+Scene::Scene(std::pmr::memory_resource *resource)
+    : Scene(SceneMemory::Heap, resource) {
+    assert(resource);
+}
+
+Scene::Scene(SceneMemory memory, std::pmr::memory_resource *resource)
+    : m_Memory(memory, resource), m_Registry(RegistryAllocator(&m_Memory)),
+      m_Id(s_NextSceneId.fetch_add(1, std::memory_order_relaxed)) {
+    m_Registry.on_construct<TagComponent>().connect<&Scene::OnTagConstruct>(this);
+    m_Registry.on_update<TagComponent>().connect<&Scene::OnTagUpdate>(this);
+    m_Registry.on_destroy<TagComponent>().connect<&Scene::OnTagDestroy>(this);
+    m_Registry.on_construct<Transform>().connect<&Scene::OnTransformConstruct>(this);
+    m_Registry.on_update<Transform>().connect<&Scene::OnTransformUpdate>(this);
+    m_Registry.on_destroy<Transform>().connect<&Scene::OnTransformDestroy>(this);
+    m_Registry.on_destroy<Hierarchy>().connect<&Scene::OnHierarchyDestroy>(this);
+    RegisterComponents(AllComponents{}, *this);
 }
 
 Scene::~Scene() {
+    m_Registry.on_construct<TagComponent>().disconnect(this);
+    m_Registry.on_update<TagComponent>().disconnect(this);
+    m_Registry.on_destroy<TagComponent>().disconnect(this);
+    m_Registry.on_construct<Transform>().disconnect(this);
+    m_Registry.on_update<Transform>().disconnect(this);
+    m_Registry.on_destroy<Transform>().disconnect(this);
+    m_Registry.on_destroy<Hierarchy>().disconnect(this);
+
+    // The pools are destroyed after this body; in an arena their blocks
+    // are not worth freeing one by one.
+    m_Memory.BeginRelease();
+}
+
+void Scene::RegisterPoolCloner(entt::id_type type, PoolCloner clone) {
+    for(const ComponentCloner &cloner: m_ComponentCloners) {
+        if(cloner.Type == type)
+            return;
+    }
+    m_ComponentCloners.push_back({type, clone});
+}
+
+size_t Scene::NextComponentIndex() {
+    return s_NextComponentIndex.fetch_add(1, std::memory_order_relaxed);
 }
 
 GameObject Scene::CreateGameObject(const std::string &name) {
@@ -16,36 +103,483 @@ GameObject Scene::CreateGameObjectWithUUID(UUID uuid, const std::string &name) {
     GameObject gameObject = {m_Registry.create(), this};
     gameObject.AddComponent<IDComponent>(uuid);
     gameObject.AddComponent<Transform>();
-    auto &tag = gameObject.AddComponent<TagComponent>();
-    tag.Tag = name.empty() ? "Empty" : name;
+    gameObject.AddComponent<TagComponent>(MakeTag(name));
 
-    m_EntityMap[uuid] = gameObject;
+    m_EntityMap.InsertOrAssign(uuid, gameObject);
 
     return gameObject;
 }
 
+std::vector<GameObject> Scene::CreateGameObjects(size_t count, const std::string &name) {
+    if(count == 0)
+        return {};
+    return CreateGameObjectsFromRange(ReserveUUIDs(count), nullptr, count, name, {});
+}
+
+std::vector<GameObject> Scene::CreateGameObjectsWithUUIDs(const std::vector<UUID> &uuids,
+                                                          const std::vector<std::string> &names) {
+    assert(names.empty() || names.size() == uuids.size());
+    return CreateGameObjectsFromRange(0, uuids.data(), uuids.size(), std::string(), names);
+}
+
+std::vector<GameObject> Scene::CreateGameObjectsFromRange(UUID firstUUID, const UUID *uuids, size_t count,
+                                                          const std::string &name, const std::vector<std::string> &names) {
+    std::vector<GameObject> gameObjects;
+    if(count == 0)
+        return gameObjects;
+
+    std::vector<entt::entity> entities(count);
+    m_Registry.create(entities.begin(), entities.end());
+
+    auto &ids = m_Registry.storage<IDComponent>();
+    auto &transforms = m_Registry.storage<Transform>();
+    auto &tags = m_Registry.storage<TagComponent>();
+    auto &worldTransforms = m_Registry.storage<WorldTransform>();
+    ids.reserve(ids.size() + count);
+    transforms.reserve(transforms.size() + count);
+    tags.reserve(tags.size() + count);
+    worldTransforms.reserve(worldTransforms.size() + count);
+    m_NameSlots.Reserve(m_NameSlots.Size() + count);
+
+    std::vector<UUID> reserved;
+    if(!uuids) {
+        reserved.resize(count);
+        for(size_t i = 0; i < count; i++)
+            reserved[i] = firstUUID + i;
+        uuids = reserved.data();
+    }
+
+    std::vector<IDComponent> idComponents(count);
+    for(size_t i = 0; i < count; i++)
+        idComponents[i].ID = uuids[i];
+
+    m_Registry.insert<IDComponent>(entities.begin(), entities.end(), idComponents.begin());
+    m_Registry.insert<Transform>(entities.begin(), entities.end());
+    if(names.empty()) {
+        m_Registry.insert<TagComponent>(entities.begin(), entities.end(), TagComponent(MakeTag(name)));
+    } else {
+        std::vector<TagComponent> tagComponents;
+        tagComponents.reserve(count);
+        for(const auto &each: names)
+            tagComponents.emplace_back(MakeTag(each));
+        m_Registry.insert<TagComponent>(entities.begin(), entities.end(), tagComponents.begin());
+    }
+
+    m_EntityMap.InsertOrAssign(uuids, entities.begin(), count);
+
+    gameObjects.reserve(count);
+    for(size_t i = 0; i < count; i++)
+        gameObjects.emplace_back(entities[i], this);
+
+    return gameObjects;
+}
+
 void Scene::DestroyGameObject(GameObject entity) {
-    m_EntityMap.erase(entity.GetUUID());
+    m_EntityMap.Erase(entity.GetUUID());
     m_Registry.destroy(entity);
 }
 
-GameObject Scene::FindGameObjectByName(const std::string &name) {
-    auto view = m_Registry.view<TagComponent>();
-    for(auto entity: view) {
-        const TagComponent &tc = view.get<TagComponent>(entity);
-        if(tc.Tag == name)
-            return GameObject{entity, this};
+std::unique_ptr<Scene> Scene::Clone() const {
+    VPP_PROFILE_FUNCTION();
+    std::unique_ptr<Scene> clone(new Scene(m_Memory.GetMemory(), m_Memory.GetExternal()));
+
+    // Same entity ids, including the free list, so every entity stored in a
+    // component or an index stays valid in the clone.
+    const auto &entities = *m_Registry.storage<entt::entity>();
+    auto &cloneEntities = clone->m_Registry.storage<entt::entity>();
+    cloneEntities.reserve(entities.size());
+    for(auto it = entities.data(), last = it + entities.size(); it != last; ++it)
+        cloneEntities.emplace(*it);
+    cloneEntities.in_use(entities.in_use());
+
+#ifndef NDEBUG
+    for(auto [type, pool]: m_Registry.storage()) {
+        bool registered = false;
+        for(const ComponentCloner &cloner: m_ComponentCloners)
+            registered = registered || cloner.Type == type;
+        assert((registered || pool.empty()) && "Clone() would drop a component type; RegisterComponent<T>() it first");
     }
-    return {};
+#endif
+    for(const ComponentCloner &cloner: m_ComponentCloners)
+        cloner.Clone(m_Registry, clone->m_Registry);
+    clone->m_ComponentCloners = m_ComponentCloners;
+
+    clone->m_EntityMap = m_EntityMap;
+    clone->m_NameIndex = m_NameIndex;
+    clone->m_NameSlots = m_NameSlots;
+    clone->m_HierarchyUnsorted = m_HierarchyUnsorted;
+    if(m_SpatialIndex)
+        clone->EnableSpatialIndex(m_SpatialIndex->GetSettings());
+
+    clone->m_ViewportWidth = m_ViewportWidth;
+    clone->m_ViewportHeight = m_ViewportHeight;
+    clone->m_FixedTimestep = m_FixedTimestep;
+    clone->m_MaxStepsPerUpdate = m_MaxStepsPerUpdate;
+    clone->m_ThreadPool = m_ThreadPool;
+    clone->m_TextureManager = m_TextureManager;
+    clone->m_AssetTimeBudget = m_AssetTimeBudget;
+
+    return clone;
+}
+
+GameObject Scene::FindGameObjectByName(std::string_view name) {
+    // A name that was never interned cannot be on any object.
+    InternedString tag;
+    if(!InternedString::Find(name, tag))
+        return {};
+
+    const NameEntities *entities = m_NameIndex.Find(tag.GetHandle());
+    if(!entities)
+        return {};
+    return GameObject{entities->First, this};
+}
+
+std::vector<GameObject> Scene::FindAllGameObjectsByName(std::string_view name) {
+    std::vector<GameObject> result;
+    InternedString tag;
+    if(!InternedString::Find(name, tag))
+        return result;
+
+    const NameEntities *entities = m_NameIndex.Find(tag.GetHandle());
+    if(!entities)
+        return result;
+
+    result.reserve(entities->Size());
+    result.emplace_back(entities->First, this);
+    for(auto entity: entities->Others)
+        result.emplace_back(entity, this);
+    return result;
 }
 
 GameObject Scene::GetGameObjectByUUID(UUID uuid) {
-    if(m_EntityMap.find(uuid) != m_EntityMap.end())
-        return {m_EntityMap.at(uuid), this};
+    if(const entt::entity *entity = m_EntityMap.Find(uuid))
+        return {*entity, this};
 
     return {};
 }
 
+void Scene::SetParent(GameObject child, GameObject parent) {
+    assert(child && child != parent);
+    auto &hierarchy = m_Registry.storage<Hierarchy>();
+
+    if(parent) {
+        for(entt::entity it = parent; it != entt::null; it = hierarchy.contains(it) ? hierarchy.get(it).Parent : entt::null)
+            assert(it != child && "cannot parent an object to its own descendant");
+
+        if(!hierarchy.contains(parent))
+            hierarchy.emplace(parent);
+    }
+
+    if(!hierarchy.contains(child)) {
+        if(!parent)
+            return;
+        hierarchy.emplace(child);
+    }
+
+    // Only links change here. A parent behind its new child breaks the pool
+    // order; SortHierarchy() restores it once, before the next propagation.
+    UnlinkChild(child);
+    if(parent) {
+        LinkChild(child, parent);
+        if(hierarchy.index(parent) > hierarchy.index(child))
+            m_HierarchyUnsorted = true;
+    }
+
+    OnTransformUpdate(m_Registry, child);
+}
+
+void Scene::UpdateWorldTransforms() {
+    VPP_PROFILE_FUNCTION();
+    auto &dirty = m_Registry.storage<TransformDirty>();
+    if(dirty.empty())
+        return;
+
+    auto &transforms = m_Registry.storage<Transform>();
+    auto &worldTransforms = m_Registry.storage<WorldTransform>();
+    auto &hierarchy = m_Registry.storage<Hierarchy>();
+    if(m_HierarchyUnsorted)
+        SortHierarchy();
+
+    // When most matrices are stale it is cheaper to stream the whole pool
+    // through the batched kernel than to visit the dirty set one by one.
+    bool rebuildAll = dirty.size() * 2 >= transforms.size();
+    if(rebuildAll) {
+        ComputeLocalMatrices();
+    } else {
+        for(auto entity: dirty) {
+            if(!hierarchy.contains(entity))
+                worldTransforms.get(entity).Matrix = transforms.get(entity).GetTransform();
+        }
+    }
+
+    // Parents come first in the pool, so a parent's matrix is final before
+    // any of its children are visited. Recomputed nodes join the dirty set so their
+    // own children follow.
+    for(auto [entity, node]: hierarchy.reach()) {
+        if(rebuildAll) {
+            if(node.Parent != entt::null)
+                worldTransforms.get(entity).Matrix = worldTransforms.get(node.Parent).Matrix * worldTransforms.get(entity).Matrix;
+            continue;
+        }
+
+        bool isDirty = dirty.contains(entity);
+        if(!isDirty && (node.Parent == entt::null || !dirty.contains(node.Parent)))
+            continue;
+
+        glm::mat4 local = transforms.get(entity).GetTransform();
+        worldTransforms.get(entity).Matrix = node.Parent == entt::null
+                                                 ? local
+                                                 : worldTransforms.get(node.Parent).Matrix * local;
+        if(!isDirty)
+            dirty.emplace(entity);
+    }
+
+    // The dirty set now holds every object whose world matrix changed,
+    // except after a full rebuild, which skips marking descendants.
+    if(m_SpatialIndex) {
+        if(rebuildAll) {
+            for(auto [entity, worldTransform]: worldTransforms.each())
+                m_SpatialIndex->Update(entity, worldTransform.Matrix[3]);
+        } else {
+            for(auto entity: dirty)
+                m_SpatialIndex->Update(entity, worldTransforms.get(entity).Matrix[3]);
+        }
+    }
+
+    dirty.clear();
+}
+
+void Scene::EnableSpatialIndex(const SpatialIndexSettings &settings) {
+    m_SpatialIndex = CreateSpatialIndex(settings);
+    for(auto [entity, worldTransform]: m_Registry.storage<WorldTransform>().each())
+        m_SpatialIndex->Update(entity, worldTransform.Matrix[3]);
+}
+
+void Scene::DisableSpatialIndex() {
+    m_SpatialIndex.reset();
+}
+
+void Scene::ComputeLocalMatrices() {
+    static_assert(sizeof(WorldTransform) == sizeof(glm::mat4), "WorldTransform must be a bare matrix");
+
+    auto &transforms = m_Registry.storage<Transform>();
+    auto &worldTransforms = m_Registry.storage<WorldTransform>();
+    assert(transforms.size() == worldTransforms.size());
+
+    // Both pools hold the same entities, so after sort_as their packed
+    // arrays line up and can be processed page by page.
+    worldTransforms.sort_as(transforms);
+
+    constexpr size_t transformPage = entt::component_traits<Transform>::page_size;
+    constexpr size_t matrixPage = entt::component_traits<WorldTransform>::page_size;
+    constexpr size_t page = transformPage < matrixPage ? transformPage : matrixPage;
+    static_assert(transformPage % page == 0 && matrixPage % page == 0, "pages must nest");
+
+    for(size_t pos = 0, size = transforms.size(); pos < size;) {
+        size_t count = std::min(page - pos % page, size - pos);
+        const Transform *first = transforms.raw()[pos / transformPage] + pos % transformPage;
+        WorldTransform *out = worldTransforms.raw()[pos / matrixPage] + pos % matrixPage;
+        ComputeTransformMatrices(first, &out->Matrix, count);
+        pos += count;
+    }
+}
+
+void Scene::OnRuntimeStart() {
+    m_IsRunning = true;
+    m_Accumulator = 0.0;
+    m_TickCount = 0;
+}
+
+void Scene::OnRuntimeStop() {
+    m_IsRunning = false;
+    m_StepFrames = 0;
+}
+
+uint32_t Scene::OnUpdate(double deltaTime) {
+    VPP_PROFILE_FUNCTION();
+    if(m_TextureManager)
+        m_TextureManager->ProcessCompletions(m_AssetTimeBudget);
+
+    if(!m_IsRunning)
+        return 0;
+
+    if(m_IsPaused) {
+        if(m_StepFrames <= 0)
+            return 0;
+
+        m_StepFrames--;
+        m_Accumulator = 0.0;
+        Tick();
+        return 1;
+    }
+
+    m_Accumulator += deltaTime;
+    uint32_t steps = 0;
+    while(m_Accumulator >= m_FixedTimestep && steps < m_MaxStepsPerUpdate) {
+        m_Accumulator -= m_FixedTimestep;
+        Tick();
+        steps++;
+    }
+
+    // Hit the catch-up cap: drop the backlog rather than spiral.
+    if(m_Accumulator >= m_FixedTimestep)
+        m_Accumulator = std::fmod(m_Accumulator, m_FixedTimestep);
+
+    return steps;
+}
+
+void Scene::Tick() {
+    VPP_PROFILE_FUNCTION();
+    RunSystems();
+    PlayCommands();
+    UpdateWorldTransforms();
+    m_TickCount++;
+}
+
+void Scene::ClearSystems() {
+    m_Organizer.clear();
+    m_SystemGraph.clear();
+    m_SystemDependencies.clear();
+    m_SystemPending.reset();
+    m_SystemsDirty = false;
+}
+
+void Scene::RunSystems() {
+    VPP_PROFILE_FUNCTION();
+    if(m_SystemsDirty)
+        BuildSystemGraph();
+    if(m_SystemGraph.empty())
+        return;
+
+    for(size_t i = 0; i < m_SystemGraph.size(); i++)
+        m_SystemPending[i].store(m_SystemDependencies[i], std::memory_order_relaxed);
+
+    // Tasks capture only (this, index) so std::function keeps them inline
+    // and a frame of systems does not allocate.
+    ThreadPool &pool = GetThreadPool();
+    for(size_t i = 0; i < m_SystemGraph.size(); i++) {
+        if(m_SystemGraph[i].top_level())
+            pool.Submit(m_SystemGroup, [this, i] { RunSystem(i); });
+    }
+    pool.Wait(m_SystemGroup);
+}
+
+void Scene::BuildSystemGraph() {
+    m_SystemGraph = m_Organizer.graph();
+    m_SystemDependencies.assign(m_SystemGraph.size(), 0);
+    m_SystemPending = std::make_unique<std::atomic<size_t>[]>(m_SystemGraph.size());
+
+    for(const auto &vertex: m_SystemGraph) {
+        for(size_t child: vertex.children())
+            m_SystemDependencies[child]++;
+
+        // Creates the pools the system touches now, so no pool is ever
+        // created while systems run in parallel.
+        vertex.prepare(m_Registry);
+    }
+
+    m_SystemsDirty = false;
+}
+
+void Scene::RunSystem(size_t index) {
+    const auto &vertex = m_SystemGraph[index];
+    {
+        VPP_PROFILE_SCOPE(vertex.name() ? vertex.name() : "System");
+        vertex.callback()(vertex.data(), m_Registry);
+    }
+
+    ThreadPool &pool = GetThreadPool();
+    for(size_t child: vertex.children()) {
+        if(m_SystemPending[child].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            pool.Submit(m_SystemGroup, [this, child] { RunSystem(child); });
+    }
+}
+
+CommandBuffer &Scene::GetCommandBuffer() {
+    // Threads keep asking the same scene, so the last answer is cached.
+    thread_local uint64_t s_LastScene = 0;
+    thread_local CommandBuffer *s_LastBuffer = nullptr;
+    if(s_LastScene == m_Id)
+        return *s_LastBuffer;
+
+    std::thread::id thread = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(m_CommandMutex);
+    CommandBuffer *buffer = nullptr;
+    for(const auto &[owner, candidate]: m_CommandBuffers) {
+        if(owner == thread)
+            buffer = candidate.get();
+    }
+    if(!buffer) {
+        m_CommandBuffers.emplace_back(thread, std::make_unique<CommandBuffer>());
+        buffer = m_CommandBuffers.back().second.get();
+    }
+
+    s_LastScene = m_Id;
+    s_LastBuffer = buffer;
+    return *buffer;
+}
+
+void Scene::PlayCommands() {
+    VPP_PROFILE_FUNCTION();
+    std::lock_guard<std::mutex> lock(m_CommandMutex);
+
+    std::vector<UUID> uuids;
+    std::vector<std::string> names;
+    bool named = false;
+    for(const auto &[owner, buffer]: m_CommandBuffers) {
+        uuids.insert(uuids.end(), buffer->m_CreatedUUIDs.begin(), buffer->m_CreatedUUIDs.end());
+        names.insert(names.end(), buffer->m_CreatedNames.begin(), buffer->m_CreatedNames.end());
+        for(const std::string &name: buffer->m_CreatedNames)
+            named = named || !name.empty();
+    }
+    if(!named)
+        names.clear();
+    std::vector<GameObject> created = CreateGameObjectsWithUUIDs(uuids, names);
+    std::vector<entt::entity> createdEntities(created.begin(), created.end());
+
+    // Component commands of every buffer, grouped by type; within a type,
+    // buffers keep their order.
+    struct PendingList {
+        entt::id_type Type;
+        CommandBuffer::ListBase *List;
+        const entt::entity *Created;
+    };
+    std::vector<PendingList> lists;
+    size_t firstCreated = 0;
+    for(const auto &[owner, buffer]: m_CommandBuffers) {
+        for(const auto &list: buffer->m_Lists) {
+            if(!list->IsEmpty())
+                lists.push_back({list->GetType(), list.get(), createdEntities.data() + firstCreated});
+        }
+        firstCreated += buffer->m_CreatedUUIDs.size();
+    }
+    std::stable_sort(lists.begin(), lists.end(), [](const PendingList &a, const PendingList &b) { return a.Type < b.Type; });
+    for(const PendingList &list: lists)
+        list.List->Play(m_Registry, list.Created);
+
+    std::vector<entt::entity> destroyed;
+    for(const auto &[owner, buffer]: m_CommandBuffers)
+        destroyed.insert(destroyed.end(), buffer->m_Destroyed.begin(), buffer->m_Destroyed.end());
+    std::sort(destroyed.begin(), destroyed.end());
+    destroyed.erase(std::unique(destroyed.begin(), destroyed.end()), destroyed.end());
+    destroyed.erase(std::remove_if(destroyed.begin(), destroyed.end(), [this](entt::entity entity) { return !m_Registry.valid(entity); }),
+                    destroyed.end());
+    if(!destroyed.empty()) {
+        auto &ids = m_Registry.storage<IDComponent>();
+        for(entt::entity entity: destroyed) {
+            if(ids.contains(entity))
+                m_EntityMap.Erase(ids.get(entity).ID);
+        }
+        // Unlinking a node dirties its children's transforms, so every
+        // hierarchy link goes before any pool is emptied.
+        m_Registry.remove<Hierarchy>(destroyed.begin(), destroyed.end());
+        m_Registry.destroy(destroyed.begin(), destroyed.end());
+    }
+
+    for(const auto &[owner, buffer]: m_CommandBuffers)
+        buffer->Clear();
+}
+
 void Scene::OnViewportResize(uint32_t width, uint32_t height) {
     if(m_ViewportWidth == width && m_ViewportHeight == height)
         return;
@@ -56,4 +590,153 @@ void Scene::OnViewportResize(uint32_t width, uint32_t height) {
     // TODO: viewport changed
 }
 
+void Scene::OnTagConstruct(Registry &registry, entt::entity entity) {
+    IndexName(entity, registry.get<TagComponent>(entity).Tag);
+}
+
+void Scene::OnTagUpdate(Registry &registry, entt::entity entity) {
+    const NameSlot *slot = m_NameSlots.Find(entity);
+    if(slot && slot->Name == registry.get<TagComponent>(entity).Tag)
+        return;
+    UnindexName(entity);
+    IndexName(entity, registry.get<TagComponent>(entity).Tag);
+}
+
+void Scene::OnTagDestroy(Registry &, entt::entity entity) {
+    UnindexName(entity);
+}
+
+void Scene::OnTransformConstruct(Registry &registry, entt::entity entity) {
+    registry.emplace_or_replace<WorldTransform>(entity);
+    OnTransformUpdate(registry, entity);
+}
+
+void Scene::OnTransformUpdate(Registry &, entt::entity entity) {
+    auto &dirty = GetStorage<TransformDirty>();
+    if(!dirty.contains(entity))
+        dirty.emplace(entity);
+}
+
+void Scene::OnTransformDestroy(Registry &registry, entt::entity entity) {
+    registry.remove<WorldTransform, TransformDirty>(entity);
+    if(m_SpatialIndex)
+        m_SpatialIndex->Remove(entity);
+}
+
+void Scene::OnHierarchyDestroy(Registry &registry, entt::entity entity) {
+    auto &hierarchy = registry.storage<Hierarchy>();
+
+    // Orphaned children become roots where they are.
+    while(hierarchy.get(entity).FirstChild != entt::null) {
+        entt::entity child = hierarchy.get(entity).FirstChild;
+        UnlinkChild(child);
+        OnTransformUpdate(registry, child);
+    }
+    UnlinkChild(entity);
+
+    // Swap-and-pop removal moves the pool's last node into this slot. The
+    // last node has no children after it, so only its parent can end up
+    // behind it.
+    entt::entity last = hierarchy.data()[hierarchy.size() - 1];
+    if(last != entity) {
+        entt::entity lastParent = hierarchy.get(last).Parent;
+        if(lastParent != entt::null && hierarchy.index(lastParent) > hierarchy.index(entity))
+            m_HierarchyUnsorted = true;
+    }
+}
+
+void Scene::LinkChild(entt::entity child, entt::entity parent) {
+    auto &hierarchy = m_Registry.storage<Hierarchy>();
+    auto &node = hierarchy.get(child);
+    auto &parentNode = hierarchy.get(parent);
+
+    node.Parent = parent;
+    node.PrevSibling = entt::null;
+    node.NextSibling = parentNode.FirstChild;
+    if(parentNode.FirstChild != entt::null)
+        hierarchy.get(parentNode.FirstChild).PrevSibling = child;
+    parentNode.FirstChild = child;
+}
+
+void Scene::UnlinkChild(entt::entity child) {
+    auto &hierarchy = m_Registry.storage<Hierarchy>();
+    auto &node = hierarchy.get(child);
+    if(node.Parent == entt::null)
+        return;
+
+    if(node.PrevSibling != entt::null)
+        hierarchy.get(node.PrevSibling).NextSibling = node.NextSibling;
+    else
+        hierarchy.get(node.Parent).FirstChild = node.NextSibling;
+
+    if(node.NextSibling != entt::null)
+        hierarchy.get(node.NextSibling).PrevSibling = node.PrevSibling;
+
+    node.Parent = entt::null;
+    node.PrevSibling = entt::null;
+    node.NextSibling = entt::null;
+}
+
+void Scene::SortHierarchy() {
+    VPP_PROFILE_FUNCTION();
+    auto &hierarchy = m_Registry.storage<Hierarchy>();
+    size_t size = hierarchy.size();
+
+    // Roots keep their relative order. Each is followed by its subtree,
+    // written straight into its final slot: one swap per node.
+    std::vector<entt::entity> stack;
+    for(size_t i = size; i-- > 0;) {
+        entt::entity entity = hierarchy.data()[i];
+        if(hierarchy.get(entity).Parent == entt::null)
+            stack.push_back(entity);
+    }
+
+    size_t position = 0;
+    while(!stack.empty()) {
+        entt::entity node = stack.back();
+        stack.pop_back();
+        // Everything before `position` is placed, so `node` is at or after it.
+        entt::entity current = hierarchy.data()[position];
+        if(current != node)
+            hierarchy.swap_elements(current, node);
+        position++;
+
+        for(entt::entity child = hierarchy.get(node).FirstChild; child != entt::null; child = hierarchy.get(child).NextSibling)
+            stack.push_back(child);
+    }
+    assert(position == size);
+
+    m_HierarchyUnsorted = false;
+}
+
+void Scene::IndexName(entt::entity entity, InternedString name) {
+    NameEntities &entities = m_NameIndex[name.GetHandle()];
+    m_NameSlots[entity] = {name, entities.Size()};
+    if(entities.First == entt::null)
+        entities.First = entity;
+    else
+        entities.Others.push_back(entity);
+}
+
+void Scene::UnindexName(entt::entity entity) {
+    const NameSlot *slot = m_NameSlots.Find(entity);
+    if(!slot)
+        return;
+
+    InternedString name = slot->Name;
+    NameEntities &entities = *m_NameIndex.Find(name.GetHandle());
+    size_t index = slot->Index;
+    size_t last = entities.Size() - 1;
+    if(index != last) {
+        entities[index] = entities[last];
+        m_NameSlots[entities[index]].Index = index;
+    }
+    if(last == 0)
+        m_NameIndex.Erase(name.GetHandle());
+    else
+        entities.Others.pop_back();
+
+    m_NameSlots.Erase(entity);
+}
+
 } // namespace VPP
\ No newline at end of file
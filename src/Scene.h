@@ -1,7 +1,26 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include <entt/entt.hpp>
-#include "GameObject.h"
+#include "CommandBuffer.h"
+#include "FlatHashMap.h"
+#include "ParallelForEach.h"
+#include "Registry.h"
+#include "SceneMemory.h"
+#include "SpatialIndex.h"
+#include "StringPool.h"
+#include "ThreadPool.h"
 #include "UUID.h"
 
 class b2World;
@@ -9,19 +28,168 @@ class b2World;
 namespace VPP {
 
 class GameObject;
+class TextureManager;
+struct PackedTransform;
+
+// Direct handle on one component pool of a Scene, for code that reads the
+// same component on many objects: each call is a single sparse-set lookup.
+// Valid for the life of the scene.
+template<typename T>
+class ComponentAccessor {
+public:
+    using Storage = Registry::storage_for_type<T>;
+
+    ComponentAccessor() = default;
+    explicit ComponentAccessor(Storage &storage)
+        : m_Storage(&storage) {}
+
+    bool Has(entt::entity entity) const {
+        return m_Storage->contains(entity);
+    }
+
+    // Like GameObject::GetComponent(): T &, or the pool's proxy type.
+    decltype(auto) Get(entt::entity entity) const {
+        return m_Storage->get(entity);
+    }
+
+    // Null if the object has no T. Only for pools that hand out T &.
+    T *TryGet(entt::entity entity) const {
+        return m_Storage->contains(entity) ? &m_Storage->get(entity) : nullptr;
+    }
+
+    Storage &GetStorage() const {
+        return *m_Storage;
+    }
+
+private:
+    Storage *m_Storage = nullptr;
+};
 
 class Scene {
 public:
     Scene();
+    explicit Scene(SceneMemory memory);
+    // Every registry allocation goes to `resource`, which must outlive the
+    // scene and its clones.
+    explicit Scene(std::pmr::memory_resource *resource);
     ~Scene();
 
     GameObject CreateGameObject(const std::string &name = std::string());
     GameObject CreateGameObjectWithUUID(UUID uuid, const std::string &name = std::string());
     void DestroyGameObject(GameObject entity);
 
-    GameObject FindGameObjectByName(const std::string &name);
+    // Batched creation: entities, pools and the UUID map are grown once for
+    // the whole range instead of once per object. `names` may be empty (every
+    // object is named `name`/"Empty") or hold one name per object.
+    std::vector<GameObject> CreateGameObjects(size_t count, const std::string &name = std::string());
+    std::vector<GameObject> CreateGameObjectsWithUUIDs(const std::vector<UUID> &uuids,
+                                                       const std::vector<std::string> &names = {});
+
+    // Forks the scene: every pool in AllComponents, and of every type given
+    // to RegisterComponent(), is copied wholesale under the same entity ids,
+    // so UUIDs, names and hierarchy links carry over. Debug builds assert
+    // that no other pool holds components.
+    // Trivially copyable pools are copied page by page. Registered systems,
+    // recorded commands and runtime state are not copied; the clone starts
+    // stopped. The clone gets its memory the same way as this scene (its
+    // own arena, if any).
+    std::unique_ptr<Scene> Clone() const;
+
+    // Makes Clone() copy the pool of T too. Clones inherit the registration.
+    template<typename T>
+    void RegisterComponent() {
+        static_assert(std::is_same_v<T, std::decay_t<T>>, "Use the plain component type");
+        RegisterPoolCloner(entt::type_hash<T>::value(), &ClonePool<T>);
+    }
+
+    SceneMemory GetMemory() const {
+        return m_Memory.GetMemory();
+    }
+    // What the registry has allocated so far; other scene state (the UUID
+    // and name indices, system bookkeeping) is not counted.
+    SceneMemoryStats GetMemoryStats() const {
+        return m_Memory.GetStats();
+    }
+
+    GameObject FindGameObjectByName(std::string_view name);
+    std::vector<GameObject> FindAllGameObjectsByName(std::string_view name);
     GameObject GetGameObjectByUUID(UUID uuid);
 
+    // Attaches `child` under `parent`, or detaches it when `parent` is null.
+    // Only the links change; if that leaves a parent behind its child in the
+    // Hierarchy pool, the pool is reordered once, at the next
+    // UpdateWorldTransforms().
+    void SetParent(GameObject child, GameObject parent);
+
+    // Recomputes WorldTransform for every object whose Transform was
+    // constructed or patched since the last call, and for all descendants
+    // of such objects.
+    void UpdateWorldTransforms();
+
+    // Keeps a spatial index of every object's world position (the
+    // translation of its WorldTransform), filled from the current world
+    // transforms and then kept up to date by UpdateWorldTransforms() from
+    // the same dirty set. Replaces any index enabled before.
+    void EnableSpatialIndex(const SpatialIndexSettings &settings = {});
+    void DisableSpatialIndex();
+
+    // Null unless enabled. Positions are those of the last
+    // UpdateWorldTransforms(); queries may run from many threads at once,
+    // but not while the scene is being updated.
+    const SpatialIndex *GetSpatialIndex() const {
+        return m_SpatialIndex.get();
+    }
+
+    void OnRuntimeStart();
+    void OnRuntimeStop();
+
+    // Publishes finished texture loads within the asset time budget, then
+    // advances a running scene by `deltaTime` seconds of wall-clock time in
+    // fixed steps of GetFixedTimestep(): each step runs the systems and then
+    // rebuilds dirty world transforms. At most GetMaxStepsPerUpdate() steps
+    // run per call; time beyond that is dropped instead of piling up. While
+    // paused only the frames requested through Step() run, one per call.
+    // Returns the number of steps taken.
+    uint32_t OnUpdate(double deltaTime);
+
+    // How far (0..1) the accumulated time is into the next fixed step, for
+    // interpolating between the last two simulated states when rendering.
+    float GetInterpolationAlpha() const {
+        return static_cast<float>(m_Accumulator / m_FixedTimestep);
+    }
+
+    void SetFixedTimestep(double seconds) {
+        assert(seconds > 0.0);
+        m_FixedTimestep = seconds;
+    }
+    double GetFixedTimestep() const {
+        return m_FixedTimestep;
+    }
+    void SetMaxStepsPerUpdate(uint32_t steps) {
+        assert(steps > 0);
+        m_MaxStepsPerUpdate = steps;
+    }
+    uint32_t GetMaxStepsPerUpdate() const {
+        return m_MaxStepsPerUpdate;
+    }
+    uint64_t GetTickCount() const {
+        return m_TickCount;
+    }
+
+    // Texture loads OnUpdate() publishes, at most `budgetSeconds` per call.
+    void SetTextureManager(TextureManager *textureManager) {
+        m_TextureManager = textureManager;
+    }
+    TextureManager *GetTextureManager() const {
+        return m_TextureManager;
+    }
+    void SetAssetTimeBudget(double budgetSeconds) {
+        m_AssetTimeBudget = budgetSeconds;
+    }
+    double GetAssetTimeBudget() const {
+        return m_AssetTimeBudget;
+    }
+
     void OnViewportResize(uint32_t width, uint32_t height);
 
     bool IsRunning() const {
@@ -35,23 +203,254 @@ public:
         m_IsPaused = paused;
     }
 
+    // Queues `frames` single steps to run while the scene is paused.
+    void Step(int frames = 1) {
+        m_StepFrames = frames;
+    }
+
+    // Registers a system for RunSystems(). Systems are free functions (or
+    // member functions bound to `instance`) whose parameters are views of
+    // the scene's registry (VPP::View<Components...>); the organizer reads
+    // each view's const/non-const components as the system's read/write
+    // set. Extra read-write requirements go in Req. Systems run concurrently,
+    // so they record creations, destructions and component adds/removes in
+    // GetCommandBuffer() instead of making them; Tick() applies those right
+    // after RunSystems().
+    template<auto Candidate, typename... Req>
+    void AddSystem(const char *name = nullptr) {
+        m_Organizer.emplace<Candidate, Req...>(name);
+        m_SystemsDirty = true;
+    }
+
+    template<auto Candidate, typename... Req, typename Type>
+    void AddSystem(Type &instance, const char *name = nullptr) {
+        m_Organizer.emplace<Candidate, Req...>(instance, name);
+        m_SystemsDirty = true;
+    }
+
+    void ClearSystems();
+
+    // Runs every registered system once. A system starts as soon as all the
+    // systems it conflicts with and that were registered before it are done.
+    void RunSystems();
+
+    // The calling thread's command buffer for this scene. Systems and
+    // ParallelForEach() callbacks record structural changes here instead
+    // of making them.
+    CommandBuffer &GetCommandBuffer();
+
+    // Applies and clears what every thread recorded: all creations in one
+    // batch, then component changes grouped by type so each pool is walked
+    // once, then all destructions in one batch. Nothing else may use the
+    // scene meanwhile. Tick() calls it once the systems are done.
+    void PlayCommands();
+
+    void SetThreadPool(ThreadPool *threadPool) {
+        m_ThreadPool = threadPool;
+    }
+    ThreadPool &GetThreadPool() {
+        return m_ThreadPool ? *m_ThreadPool : ThreadPool::GetDefault();
+    }
+
+    // The pool of T, created on first use and valid for the life of the
+    // scene. After the first call the pool comes from a per-scene table
+    // indexed by a process-wide component number, instead of the
+    // registry's hash map of pools.
+    template<typename T>
+    Registry::storage_for_type<T> &GetStorage() {
+        static_assert(std::is_same_v<T, std::decay_t<T>>, "Use the plain component type");
+        size_t index = GetComponentIndex<T>();
+        if(index < MaxCachedStorages) {
+            if(RegistrySparseSet *storage = m_Storages[index].load(std::memory_order_acquire))
+                return static_cast<Registry::storage_for_type<T> &>(*storage);
+        }
+
+        auto &storage = m_Registry.storage<T>();
+        if(index < MaxCachedStorages)
+            m_Storages[index].store(&storage, std::memory_order_release);
+        return storage;
+    }
+
+    template<typename T>
+    ComponentAccessor<T> GetComponentAccessor() {
+        return ComponentAccessor<T>(GetStorage<T>());
+    }
+
     template<typename... Components>
     auto GetAllGameObjectsWith() {
         return m_Registry.view<Components...>();
     }
 
+    // Parallel counterpart of GetAllGameObjectsWith<Components...>().each():
+    // func(entity, components &...) runs on the scene's thread pool, one
+    // chunk of `grainSize` objects per task.
+    template<typename... Components, typename Func>
+    void ParallelForEach(Func func, size_t grainSize = DefaultParallelGrainSize) {
+        VPP::ParallelForEach(GetThreadPool(), m_Registry.view<Components...>(), std::move(func), grainSize);
+    }
+
 private:
+    // Component types numbered past this are looked up in the registry
+    // every time.
+    static constexpr size_t MaxCachedStorages = 64;
+
+    static size_t NextComponentIndex();
+
+    using PoolCloner = void (*)(const Registry &source, Registry &target);
+
+    struct ComponentCloner {
+        entt::id_type Type;
+        PoolCloner Clone;
+    };
+
+    void RegisterPoolCloner(entt::id_type type, PoolCloner clone);
+
+    template<typename Type>
+    static void ClonePool(const Registry &source, Registry &target);
+
+    template<typename T>
+    static size_t GetComponentIndex() {
+        static const size_t s_Index = NextComponentIndex();
+        return s_Index;
+    }
+
+    struct NameSlot {
+        InternedString Name;
+        size_t Index;
+    };
+
+    // Entities carrying one name. The first is kept inline, so looking up a
+    // name touches nothing but its index slot.
+    struct NameEntities {
+        entt::entity First{entt::null};
+        std::vector<entt::entity> Others;
+
+        size_t Size() const {
+            return First == entt::null ? 0 : Others.size() + 1;
+        }
+        entt::entity &operator[](size_t index) {
+            return index == 0 ? First : Others[index - 1];
+        }
+    };
+
+    Scene(SceneMemory memory, std::pmr::memory_resource *resource);
+
+    void OnTagConstruct(Registry &registry, entt::entity entity);
+    void OnTagUpdate(Registry &registry, entt::entity entity);
+    void OnTagDestroy(Registry &registry, entt::entity entity);
+
+    std::vector<GameObject> CreateGameObjectsFromRange(UUID firstUUID, const UUID *uuids, size_t count,
+                                                       const std::string &name, const std::vector<std::string> &names);
+
+    void ComputeLocalMatrices();
+
+    void Tick();
+
+    void BuildSystemGraph();
+    void RunSystem(size_t index);
+
+    void OnTransformConstruct(Registry &registry, entt::entity entity);
+    void OnTransformUpdate(Registry &registry, entt::entity entity);
+    void OnTransformDestroy(Registry &registry, entt::entity entity);
+
+    void OnHierarchyDestroy(Registry &registry, entt::entity entity);
+
+    void LinkChild(entt::entity child, entt::entity parent);
+    void UnlinkChild(entt::entity child);
+    // Puts the Hierarchy pool back in depth-first order, in O(size).
+    void SortHierarchy();
+
+    void IndexName(entt::entity entity, InternedString name);
+    void UnindexName(entt::entity entity);
+
 private:
-    entt::registry m_Registry;
+    // Declared first: the registry gives its memory back on destruction.
+    SceneMemoryResource m_Memory;
+    Registry m_Registry;
+    // Pools by GetComponentIndex(); null until first asked for. Atomic so
+    // threads running systems may fill in pools that already exist.
+    std::atomic<RegistrySparseSet *> m_Storages[MaxCachedStorages] = {};
+    // How Clone() copies each pool, by pool id.
+    std::vector<ComponentCloner> m_ComponentCloners;
     uint32_t m_ViewportWidth = 0;
     uint32_t m_ViewportHeight = 0;
     bool m_IsRunning = false;
     bool m_IsPaused = false;
     int m_StepFrames = 0;
 
-    std::unordered_map<UUID, entt::entity> m_EntityMap;
+    double m_FixedTimestep = 1.0 / 60.0;
+    double m_Accumulator = 0.0;
+    uint32_t m_MaxStepsPerUpdate = 8;
+    uint64_t m_TickCount = 0;
+
+    TextureManager *m_TextureManager = nullptr;
+    double m_AssetTimeBudget = 0.002;
+
+    FlatHashMap<UUID, entt::entity> m_EntityMap;
+
+    // Set when some parent sits behind one of its children in the
+    // Hierarchy pool.
+    bool m_HierarchyUnsorted = false;
+
+    std::unique_ptr<SpatialIndex> m_SpatialIndex;
+
+    Organizer m_Organizer;
+    std::vector<Organizer::vertex> m_SystemGraph;
+    std::vector<size_t> m_SystemDependencies;
+    std::unique_ptr<std::atomic<size_t>[]> m_SystemPending;
+    bool m_SystemsDirty = false;
+    TaskGroup m_SystemGroup;
+    ThreadPool *m_ThreadPool = nullptr;
+
+    // One command buffer per thread that ever asked for one. m_Id tells
+    // scenes apart in the per-thread lookup cache, even at a reused address.
+    uint64_t m_Id;
+    std::mutex m_CommandMutex;
+    std::vector<std::pair<std::thread::id, std::unique_ptr<CommandBuffer>>> m_CommandBuffers;
+
+    // Interned TagComponent name -> entities carrying it. m_NameSlots
+    // remembers where each entity sits so renames and destruction can
+    // swap-remove it without a scan.
+    FlatHashMap<uint32_t, NameEntities> m_NameIndex;
+    FlatHashMap<entt::entity, NameSlot> m_NameSlots;
 
     friend class GameObject;
+    friend class SceneDeltaLoader;
+    friend class SceneDeltaRecorder;
+    friend class SceneSerializer;
 };
 
+// Copies `source`'s pool of Type into the empty pool of `target`, keeping
+// the packed order. Writes go to the underlying storage directly, so the
+// target's construct signals (name index, dirty marking) do not fire; Clone
+// copies their results instead.
+template<typename Type>
+void Scene::ClonePool(const Registry &source, Registry &target) {
+    const auto *from = source.storage<Type>();
+    if(!from || from->empty())
+        return;
+
+    const entt::entity *entities = from->data();
+    size_t count = from->size();
+    auto &to = static_cast<RegistryStorage<Type> &>(target.storage<Type>());
+
+    if constexpr(entt::component_traits<Type>::page_size == 0) {
+        to.insert(entities, entities + count);
+    } else if constexpr(std::is_trivially_copyable_v<Type>) {
+        to.insert(entities, entities + count);
+
+        constexpr size_t pageSize = entt::component_traits<Type>::page_size;
+        const Type *const *fromPages = from->raw();
+        Type **toPages = to.raw();
+        for(size_t first = 0, page = 0; first < count; first += pageSize, page++)
+            std::memcpy(toPages[page], fromPages[page], std::min(pageSize, count - first) * sizeof(Type));
+    } else {
+        // rbegin() walks the packed array front to back, like data().
+        to.insert(entities, entities + count, from->rbegin());
+    }
+}
+
+template<>
+void Scene::ClonePool<PackedTransform>(const Registry &source, Registry &target);
+
 } // namespace VPP
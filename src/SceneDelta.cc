@@ -0,0 +1,288 @@
+#include "SceneDelta.h"
+#include <cassert>
+#include <cstring>
+#include "GameObject.h"
+#include "Profiler.h"
+#include "Scene.h"
+#include "SnapshotArchive.h"
+
+namespace VPP {
+
+namespace {
+
+// Sections, in order: touched entities, changed IDComponent, TagComponent
+// and Transform values, entities that lost their TagComponent or Transform,
+// and the UUIDs of destroyed objects (values only).
+constexpr uint32_t DeltaMagic = 0x44505056; // "VPPD"
+constexpr uint32_t DeltaVersion = 2;
+constexpr uint32_t DeltaSectionCount = 7;
+
+struct DeltaHeader {
+    SnapshotHeader Base;
+    uint64_t Sequence;
+    uint64_t Reserved;
+};
+
+static_assert(sizeof(DeltaHeader) % SnapshotAlignment == 0);
+
+void Mark(entt::sparse_set &set, entt::entity entity) {
+    if(!set.contains(entity))
+        set.push(entity);
+}
+
+void WriteEntities(SnapshotOutputArchive &archive, const entt::sparse_set &set) {
+    archive.BeginSection();
+    archive(static_cast<uint32_t>(set.size()));
+    for(auto entity: set) archive(entity);
+    archive.EndSection();
+}
+
+} // namespace
+
+template<>
+entt::sparse_set &SceneDeltaRecorder::GetChanged<IDComponent>() {
+    return m_ChangedIDs;
+}
+
+template<>
+entt::sparse_set &SceneDeltaRecorder::GetChanged<TagComponent>() {
+    return m_ChangedTags;
+}
+
+template<>
+entt::sparse_set &SceneDeltaRecorder::GetChanged<Transform>() {
+    return m_ChangedTransforms;
+}
+
+template<>
+entt::sparse_set &SceneDeltaRecorder::GetRemoved<TagComponent>() {
+    return m_RemovedTags;
+}
+
+template<>
+entt::sparse_set &SceneDeltaRecorder::GetRemoved<Transform>() {
+    return m_RemovedTransforms;
+}
+
+SceneDeltaRecorder::SceneDeltaRecorder(Scene &scene)
+    : m_Scene(&scene) {
+    Registry &registry = m_Scene->m_Registry;
+    registry.on_construct<IDComponent>().connect<&SceneDeltaRecorder::OnIDConstruct>(this);
+    registry.on_update<IDComponent>().connect<&SceneDeltaRecorder::OnChanged<IDComponent>>(this);
+    registry.on_destroy<IDComponent>().connect<&SceneDeltaRecorder::OnIDDestroy>(this);
+    registry.on_construct<TagComponent>().connect<&SceneDeltaRecorder::OnChanged<TagComponent>>(this);
+    registry.on_update<TagComponent>().connect<&SceneDeltaRecorder::OnChanged<TagComponent>>(this);
+    registry.on_destroy<TagComponent>().connect<&SceneDeltaRecorder::OnRemoved<TagComponent>>(this);
+    registry.on_construct<Transform>().connect<&SceneDeltaRecorder::OnChanged<Transform>>(this);
+    registry.on_update<Transform>().connect<&SceneDeltaRecorder::OnChanged<Transform>>(this);
+    registry.on_destroy<Transform>().connect<&SceneDeltaRecorder::OnRemoved<Transform>>(this);
+
+    // The first delta is the base: everything that exists now.
+    for(auto entity: registry.view<IDComponent>())
+        OnIDConstruct(registry, entity);
+}
+
+SceneDeltaRecorder::~SceneDeltaRecorder() {
+    Registry &registry = m_Scene->m_Registry;
+    registry.on_construct<IDComponent>().disconnect(this);
+    registry.on_update<IDComponent>().disconnect(this);
+    registry.on_destroy<IDComponent>().disconnect(this);
+    registry.on_construct<TagComponent>().disconnect(this);
+    registry.on_update<TagComponent>().disconnect(this);
+    registry.on_destroy<TagComponent>().disconnect(this);
+    registry.on_construct<Transform>().disconnect(this);
+    registry.on_update<Transform>().disconnect(this);
+    registry.on_destroy<Transform>().disconnect(this);
+}
+
+bool SceneDeltaRecorder::HasChanges() const {
+    return m_Sequence == 0 || !m_ChangedIDs.empty() || !m_ChangedTags.empty() || !m_ChangedTransforms.empty()
+           || !m_RemovedTags.empty() || !m_RemovedTransforms.empty() || !m_DestroyedUUIDs.empty();
+}
+
+void SceneDeltaRecorder::WriteDelta(std::vector<uint8_t> &out) {
+    VPP_PROFILE_FUNCTION();
+    const Registry &registry = m_Scene->m_Registry;
+
+    DeltaHeader header = {{DeltaMagic, DeltaVersion, DeltaSectionCount, 0}, m_Sequence, 0};
+    const auto *bytes = reinterpret_cast<const uint8_t *>(&header);
+    out.insert(out.end(), bytes, bytes + sizeof(header));
+
+    // Every entity the loader has to know about, each listed once.
+    entt::sparse_set touched;
+    for(auto entity: m_ChangedIDs) Mark(touched, entity);
+    for(auto entity: m_ChangedTags) Mark(touched, entity);
+    for(auto entity: m_ChangedTransforms) Mark(touched, entity);
+
+    SnapshotOutputArchive archive(out);
+    archive.BeginSection();
+    archive(static_cast<uint32_t>(touched.size()));
+    archive(static_cast<uint32_t>(touched.size()));
+    for(auto entity: touched) archive(entity);
+    archive.EndSection();
+
+    const RegistrySnapshot snapshot{registry};
+    archive.BeginSection();
+    snapshot.get<IDComponent>(archive, m_ChangedIDs.begin(), m_ChangedIDs.end());
+    archive.EndSection();
+    archive.BeginSection();
+    snapshot.get<TagComponent>(archive, m_ChangedTags.begin(), m_ChangedTags.end());
+    archive.EndSection();
+    archive.BeginSection();
+    snapshot.get<Transform>(archive, m_ChangedTransforms.begin(), m_ChangedTransforms.end());
+    archive.EndSection();
+
+    WriteEntities(archive, m_RemovedTags);
+    WriteEntities(archive, m_RemovedTransforms);
+
+    archive.BeginSection();
+    archive(uint32_t(0));
+    for(UUID uuid: m_DestroyedUUIDs) archive(uuid);
+    archive.EndSection();
+    assert(archive.IsValid());
+
+    m_ChangedIDs.clear();
+    m_ChangedTags.clear();
+    m_ChangedTransforms.clear();
+    m_RemovedTags.clear();
+    m_RemovedTransforms.clear();
+    m_DestroyedUUIDs.clear();
+    m_Sequence++;
+}
+
+template<typename Type>
+void SceneDeltaRecorder::OnChanged(Registry &registry, entt::entity entity) {
+    // Objects only exist for the delta once they have an id.
+    if(!registry.all_of<IDComponent>(entity))
+        return;
+
+    Mark(GetChanged<Type>(), entity);
+    if constexpr(!std::is_same_v<Type, IDComponent>)
+        GetRemoved<Type>().remove(entity);
+}
+
+template<typename Type>
+void SceneDeltaRecorder::OnRemoved(Registry &registry, entt::entity entity) {
+    GetChanged<Type>().remove(entity);
+    // While an object is destroyed its IDComponent may already be gone, in
+    // which case OnIDDestroy covers it.
+    if(registry.all_of<IDComponent>(entity))
+        Mark(GetRemoved<Type>(), entity);
+}
+
+void SceneDeltaRecorder::OnIDConstruct(Registry &registry, entt::entity entity) {
+    Mark(m_ChangedIDs, entity);
+    if(registry.all_of<TagComponent>(entity))
+        Mark(m_ChangedTags, entity);
+    if(registry.all_of<Transform>(entity))
+        Mark(m_ChangedTransforms, entity);
+}
+
+void SceneDeltaRecorder::OnIDDestroy(Registry &registry, entt::entity entity) {
+    m_DestroyedUUIDs.push_back(registry.get<IDComponent>(entity).ID);
+    m_ChangedIDs.remove(entity);
+    m_ChangedTags.remove(entity);
+    m_ChangedTransforms.remove(entity);
+    m_RemovedTags.remove(entity);
+    m_RemovedTransforms.remove(entity);
+}
+
+SceneDeltaLoader::SceneDeltaLoader(Scene &scene)
+    : m_Scene(&scene), m_Loader(scene.m_Registry) {
+}
+
+bool SceneDeltaLoader::ApplyDelta(const uint8_t *data, size_t size) {
+    VPP_PROFILE_FUNCTION();
+    // Sections are read in place, which needs the alignment of their values.
+    assert(reinterpret_cast<uintptr_t>(data) % alignof(std::max_align_t) == 0);
+
+    DeltaHeader header;
+    if(size < sizeof(header))
+        return false;
+    std::memcpy(&header, data, sizeof(header));
+    if(header.Base.Magic != DeltaMagic || header.Base.Version != DeltaVersion
+       || header.Base.SectionCount != DeltaSectionCount || header.Sequence != m_NextSequence)
+        return false;
+
+    SnapshotSectionView sections[DeltaSectionCount];
+    if(!ReadSnapshotSections(data, size, sizeof(header), sections, DeltaSectionCount))
+        return false;
+
+    Registry &registry = m_Scene->m_Registry;
+    auto &entityMap = m_Scene->m_EntityMap;
+
+    // Destroyed objects go first: their source entity may already have been
+    // recycled for an object created in the same delta.
+    const SnapshotSectionView &destroyed = sections[6];
+    if(destroyed.Header.ValueBytes % sizeof(UUID) != 0)
+        return false;
+    for(uint64_t offset = 0; offset < destroyed.Header.ValueBytes; offset += sizeof(UUID)) {
+        UUID uuid;
+        std::memcpy(&uuid, destroyed.Values + offset, sizeof(uuid));
+        if(GameObject gameObject = m_Scene->GetGameObjectByUUID(uuid))
+            m_Scene->DestroyGameObject(gameObject);
+    }
+
+    SnapshotInputArchive entityArchive(sections[0]);
+    m_Loader.get<entt::entity>(entityArchive);
+
+    // continuous_loader::get<Component> would strip the component from every
+    // entity missing from the section, so components are applied one by one
+    // through the loader's mapping instead.
+    auto map = [this](entt::entity entity) {
+        return m_Loader.contains(entity) ? m_Loader.map(entity) : entt::entity{entt::null};
+    };
+
+    const SnapshotSectionView &ids = sections[1];
+    const auto *idValues = GetSnapshotValues<IDComponent>(ids);
+    if(!idValues)
+        return false;
+    for(uint32_t i = 0; i < ids.Header.Count; i++) {
+        entt::entity entity = map(ids.Entities[i]);
+        if(entity == entt::null)
+            return false;
+
+        if(auto *id = registry.try_get<IDComponent>(entity); id && id->ID != idValues[i].ID)
+            entityMap.Erase(id->ID);
+        registry.emplace_or_replace<IDComponent>(entity, idValues[i]);
+        entityMap.InsertOrAssign(idValues[i].ID, entity);
+    }
+
+    const SnapshotSectionView &tags = sections[2];
+    SnapshotInputArchive tagArchive(tags);
+    for(uint32_t i = 0; i < tags.Header.Count; i++) {
+        entt::entity source;
+        TagComponent tag;
+        tagArchive(source);
+        tagArchive(tag);
+        entt::entity entity = map(source);
+        if(!tagArchive.IsValid() || entity == entt::null)
+            return false;
+        registry.emplace_or_replace<TagComponent>(entity, std::move(tag));
+    }
+
+    const SnapshotSectionView &transforms = sections[3];
+    const auto *transformValues = GetSnapshotValues<Transform>(transforms);
+    if(!transformValues)
+        return false;
+    for(uint32_t i = 0; i < transforms.Header.Count; i++) {
+        entt::entity entity = map(transforms.Entities[i]);
+        if(entity == entt::null)
+            return false;
+        registry.emplace_or_replace<Transform>(entity, transformValues[i]);
+    }
+
+    for(uint32_t i = 0; i < sections[4].Header.Count; i++) {
+        if(entt::entity entity = map(sections[4].Entities[i]); entity != entt::null)
+            registry.remove<TagComponent>(entity);
+    }
+    for(uint32_t i = 0; i < sections[5].Header.Count; i++) {
+        if(entt::entity entity = map(sections[5].Entities[i]); entity != entt::null)
+            registry.remove<Transform>(entity);
+    }
+
+    m_NextSequence++;
+    return true;
+}
+
+} // namespace VPP
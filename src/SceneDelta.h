@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <entt/entt.hpp>
+#include "Registry.h"
+#include "UUID.h"
+
+namespace VPP {
+
+class Scene;
+
+// Records which objects of a scene were created, changed or destroyed, and
+// which of their IDComponent, TagComponent and Transform components were
+// added, patched or removed, and writes that as a delta. The first delta
+// after construction holds every object and is the base the others build
+// on. Changes only register through the registry's signals, i.e. through
+// emplace/patch/replace/remove, like TransformDirty.
+class SceneDeltaRecorder {
+public:
+    explicit SceneDeltaRecorder(Scene &scene);
+    ~SceneDeltaRecorder();
+
+    SceneDeltaRecorder(const SceneDeltaRecorder &) = delete;
+    SceneDeltaRecorder &operator=(const SceneDeltaRecorder &) = delete;
+
+    bool HasChanges() const;
+
+    // Number of deltas written so far; the next delta carries this number.
+    uint64_t GetSequence() const {
+        return m_Sequence;
+    }
+
+    // Appends everything recorded since the previous call to `out` and
+    // starts recording the next delta.
+    void WriteDelta(std::vector<uint8_t> &out);
+
+private:
+    template<typename Type>
+    void OnChanged(Registry &registry, entt::entity entity);
+    template<typename Type>
+    void OnRemoved(Registry &registry, entt::entity entity);
+    void OnIDConstruct(Registry &registry, entt::entity entity);
+    void OnIDDestroy(Registry &registry, entt::entity entity);
+
+    template<typename Type>
+    entt::sparse_set &GetChanged();
+    template<typename Type>
+    entt::sparse_set &GetRemoved();
+
+private:
+    Scene *m_Scene;
+    uint64_t m_Sequence = 0;
+
+    entt::sparse_set m_ChangedIDs;
+    entt::sparse_set m_ChangedTags;
+    entt::sparse_set m_ChangedTransforms;
+    entt::sparse_set m_RemovedTags;
+    entt::sparse_set m_RemovedTransforms;
+    std::vector<UUID> m_DestroyedUUIDs;
+};
+
+// Applies the deltas of a SceneDeltaRecorder, in order, to another scene.
+// Entity ids of the source are remapped to local ones by an
+// entt::continuous_loader; destroyed objects are looked up by UUID.
+class SceneDeltaLoader {
+public:
+    explicit SceneDeltaLoader(Scene &scene);
+
+    // Returns false for a malformed delta or one that is out of sequence;
+    // a delta that fails half way may have been partially applied.
+    bool ApplyDelta(const uint8_t *data, size_t size);
+
+    uint64_t GetNextSequence() const {
+        return m_NextSequence;
+    }
+
+private:
+    Scene *m_Scene;
+    RegistryContinuousLoader m_Loader;
+    uint64_t m_NextSequence = 0;
+};
+
+} // namespace VPP
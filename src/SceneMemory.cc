@@ -0,0 +1,63 @@
+#include "SceneMemory.h"
+#include <algorithm>
+
+namespace VPP {
+
+namespace {
+
+// First block the arena takes from the heap; later ones grow geometrically.
+constexpr size_t ArenaInitialBytes = 64 * 1024;
+// Blocks up to this size (component pages, sparse pages, small packed
+// arrays) come from the arena. Larger ones are the packed arrays of big
+// pools, which grow by doubling: the arena could not reuse what they leave
+// behind, so they stay on the heap, and they are few enough to free one by
+// one.
+constexpr size_t ArenaLargestBlock = 256 * 1024;
+
+bool IsArenaBlock(size_t bytes) {
+    return bytes <= ArenaLargestBlock;
+}
+
+} // namespace
+
+SceneMemoryResource::SceneMemoryResource(SceneMemory memory, std::pmr::memory_resource *upstream)
+    : m_Memory(memory), m_External(upstream) {
+    if(m_External) {
+        m_Upstream = m_External;
+    } else if(m_Memory == SceneMemory::Arena) {
+        std::pmr::pool_options options;
+        options.largest_required_pool_block = ArenaLargestBlock;
+        m_Arena = std::make_unique<std::pmr::monotonic_buffer_resource>(ArenaInitialBytes);
+        m_ArenaPool = std::make_unique<std::pmr::unsynchronized_pool_resource>(options, m_Arena.get());
+        m_Upstream = m_ArenaPool.get();
+    } else {
+        m_Upstream = std::pmr::new_delete_resource();
+    }
+}
+
+void *SceneMemoryResource::do_allocate(size_t bytes, size_t alignment) {
+    void *pointer = GetUpstream(bytes)->allocate(bytes, alignment);
+    m_Stats.BytesInUse += bytes;
+    m_Stats.PeakBytes = std::max(m_Stats.PeakBytes, m_Stats.BytesInUse);
+    m_Stats.Allocations++;
+    return pointer;
+}
+
+void SceneMemoryResource::do_deallocate(void *pointer, size_t bytes, size_t alignment) {
+    if(!m_Releasing || !IsArenaBlock(bytes))
+        GetUpstream(bytes)->deallocate(pointer, bytes, alignment);
+    m_Stats.BytesInUse -= bytes;
+    m_Stats.Deallocations++;
+}
+
+std::pmr::memory_resource *SceneMemoryResource::GetUpstream(size_t bytes) const {
+    if(m_ArenaPool && !IsArenaBlock(bytes))
+        return std::pmr::new_delete_resource();
+    return m_Upstream;
+}
+
+bool SceneMemoryResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+    return this == &other;
+}
+
+} // namespace VPP
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+namespace VPP {
+
+// Where a Scene's registry gets its memory from.
+enum class SceneMemory {
+    // The global heap, one allocation per pool block.
+    Heap,
+    // An arena owned by the scene. Blocks a pool gives back are recycled
+    // inside the scene, and destroying the scene drops the pools without
+    // freeing their blocks one by one: the arena goes back to the heap in a
+    // few large frees.
+    Arena,
+};
+
+struct SceneMemoryStats {
+    // Bytes currently allocated by the registry, and the most ever held.
+    size_t BytesInUse = 0;
+    size_t PeakBytes = 0;
+    // Allocations and frees since the scene was created.
+    size_t Allocations = 0;
+    size_t Deallocations = 0;
+};
+
+// The memory resource behind a Scene's registry: forwards to the heap, to a
+// scene-owned arena or to a resource supplied by the caller, and counts
+// everything that passes through. Like structural changes to the registry,
+// allocation is not thread-safe.
+class SceneMemoryResource: public std::pmr::memory_resource {
+public:
+    // `upstream`, when not null, is used instead of `memory` and must
+    // outlive the resource.
+    SceneMemoryResource(SceneMemory memory, std::pmr::memory_resource *upstream);
+
+    SceneMemoryResource(const SceneMemoryResource &) = delete;
+    SceneMemoryResource &operator=(const SceneMemoryResource &) = delete;
+
+    SceneMemory GetMemory() const {
+        return m_Memory;
+    }
+    // The caller's resource, or null.
+    std::pmr::memory_resource *GetExternal() const {
+        return m_External;
+    }
+
+    SceneMemoryStats GetStats() const {
+        return m_Stats;
+    }
+
+    // Called when the scene is being destroyed: from then on, frees of
+    // blocks the arena releases anyway are dropped.
+    void BeginRelease() {
+        m_Releasing = m_Arena != nullptr;
+    }
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *pointer, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+    std::pmr::memory_resource *GetUpstream(size_t bytes) const;
+
+private:
+    SceneMemory m_Memory;
+    std::pmr::memory_resource *m_External;
+    // Arena mode: the pool recycles freed blocks by size and takes its
+    // chunks from the monotonic buffer, which is released as a whole after
+    // the pool is gone. Blocks too large for the pool use the heap.
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> m_Arena;
+    std::unique_ptr<std::pmr::unsynchronized_pool_resource> m_ArenaPool;
+    std::pmr::memory_resource *m_Upstream;
+    bool m_Releasing = false;
+
+    SceneMemoryStats m_Stats;
+};
+
+} // namespace VPP
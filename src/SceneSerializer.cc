@@ -0,0 +1,141 @@
+#include "SceneSerializer.h"
+#include <cstdio>
+#include <vector>
+#include "GameObject.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+#include "Scene.h"
+#include "SnapshotArchive.h"
+
+namespace VPP {
+
+namespace {
+
+// Sections, in order: entities, IDComponent, TagComponent, Transform.
+constexpr uint32_t SnapshotMagic = 0x53505056; // "VPPS"
+constexpr uint32_t SnapshotVersion = 2;
+constexpr uint32_t SnapshotSectionCount = 4;
+
+// Plain-data pools skip the archive: the mapped arrays are the pool's
+// entities and components already, so they go in with one bulk insert.
+template<typename Type>
+bool InsertPlainPool(Registry &registry, const SnapshotSectionView &section) {
+    const Type *values = GetSnapshotValues<Type>(section);
+    if(!values)
+        return false;
+
+    uint32_t count = section.Header.Count;
+    for(uint32_t i = 0; i < count; i++) {
+        if(!registry.valid(section.Entities[i]))
+            return false;
+    }
+
+    auto &storage = registry.storage<Type>();
+    storage.reserve(storage.size() + count);
+    registry.insert<Type>(section.Entities, section.Entities + count, values);
+    return true;
+}
+
+} // namespace
+
+SceneSerializer::SceneSerializer(Scene &scene)
+    : m_Scene(&scene) {
+}
+
+bool SceneSerializer::SerializeBinary(const std::string &path) {
+    VPP_PROFILE_FUNCTION();
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if(!file)
+        return false;
+
+    SnapshotHeader header = {SnapshotMagic, SnapshotVersion, SnapshotSectionCount, 0};
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+    // Sections are written out one pool at a time, so only the largest pool
+    // is ever buffered.
+    std::vector<uint8_t> buffer;
+    SnapshotOutputArchive archive(buffer);
+    auto flush = [&] {
+        archive.EndSection();
+        if(!buffer.empty() && std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+            ok = false;
+        buffer.clear();
+        archive.BeginSection();
+    };
+
+    const RegistrySnapshot snapshot{m_Scene->m_Registry};
+    archive.BeginSection();
+    snapshot.get<entt::entity>(archive);
+    flush();
+    snapshot.get<IDComponent>(archive);
+    flush();
+    snapshot.get<TagComponent>(archive);
+    flush();
+    snapshot.get<Transform>(archive);
+    flush();
+
+    ok = archive.IsValid() && ok;
+    return std::fclose(file) == 0 && ok;
+}
+
+bool SceneSerializer::DeserializeBinary(const std::string &path) {
+    VPP_PROFILE_FUNCTION();
+    Registry &registry = m_Scene->m_Registry;
+    for(auto [id, storage]: registry.storage()) {
+        if(!storage.empty())
+            return false;
+    }
+
+    MappedFile file(path);
+    if(!file.IsOpen() || file.GetSize() < sizeof(SnapshotHeader))
+        return false;
+
+    SnapshotHeader header;
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    if(header.Magic != SnapshotMagic || header.Version != SnapshotVersion || header.SectionCount != SnapshotSectionCount)
+        return false;
+
+    SnapshotSectionView sections[SnapshotSectionCount];
+    if(!ReadSnapshotSections(file.GetData(), file.GetSize(), sizeof(header), sections, SnapshotSectionCount))
+        return false;
+
+    const SnapshotSectionView &entities = sections[0];
+    const SnapshotSectionView &ids = sections[1];
+    const SnapshotSectionView &tags = sections[2];
+    const SnapshotSectionView &transforms = sections[3];
+
+    RegistrySnapshotLoader loader{registry};
+    SnapshotInputArchive entityArchive(entities);
+    loader.get<entt::entity>(entityArchive);
+
+    if(!InsertPlainPool<IDComponent>(registry, ids))
+        return false;
+
+    // Rebuilt in one pass over the mapped ids rather than per object.
+    const auto *idValues = GetSnapshotValues<IDComponent>(ids);
+    m_Scene->m_EntityMap.Reserve(m_Scene->m_EntityMap.Size() + ids.Header.Count);
+    for(uint32_t i = 0; i < ids.Header.Count; i++)
+        m_Scene->m_EntityMap.InsertOrAssign(idValues[i].ID, ids.Entities[i]);
+
+    // Every distinct name is interned once; the tags themselves are only
+    // indices into the section's string table.
+    std::vector<InternedString> names;
+    if(!ReadSnapshotStrings(tags, names))
+        return false;
+    const auto *nameIndices = reinterpret_cast<const uint32_t *>(tags.Values);
+    std::vector<TagComponent> tagValues(tags.Header.Count);
+    for(uint32_t i = 0; i < tags.Header.Count; i++) {
+        if(!registry.valid(tags.Entities[i]) || nameIndices[i] >= names.size())
+            return false;
+        tagValues[i].Tag = names[nameIndices[i]];
+    }
+    registry.storage<TagComponent>().reserve(tags.Header.Count);
+    m_Scene->m_NameSlots.Reserve(m_Scene->m_NameSlots.Size() + tags.Header.Count);
+    m_Scene->m_NameIndex.Reserve(m_Scene->m_NameIndex.Size() + names.size());
+    registry.insert<TagComponent>(tags.Entities, tags.Entities + tags.Header.Count, tagValues.begin());
+
+    registry.storage<WorldTransform>().reserve(transforms.Header.Count);
+    return InsertPlainPool<Transform>(registry, transforms);
+}
+
+} // namespace VPP
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+namespace VPP {
+
+class Scene;
+
+// Binary checkpoints of a scene's IDComponent, TagComponent and Transform
+// pools. Every pool is stored as one contiguous section, entities first and
+// components after, so plain-data pools load with a single bulk insert
+// straight out of the memory-mapped file.
+class SceneSerializer {
+public:
+    explicit SceneSerializer(Scene &scene);
+
+    bool SerializeBinary(const std::string &path);
+
+    // The scene must be freshly constructed: entity ids are restored as
+    // they were saved. Returns false on I/O errors or a malformed file, in
+    // which case the scene may hold a partial load and should be discarded.
+    bool DeserializeBinary(const std::string &path);
+
+private:
+    Scene *m_Scene;
+};
+
+} // namespace VPP
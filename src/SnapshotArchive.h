@@ -0,0 +1,271 @@
+#pragma once
+
+// Internal to SceneSerializer.cc and SceneDelta.cc: the section layout
+// shared by full snapshots and delta streams, and the archives that move
+// entt snapshot data in and out of it.
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include <entt/entt.hpp>
+#include "FlatHashMap.h"
+#include "GameObject.h"
+#include "StringPool.h"
+
+namespace VPP {
+
+// A stream is a SnapshotHeader followed by SectionCount sections. A section
+// is a SnapshotSectionHeader, the pool's entities and then its component
+// values, each padded to SnapshotAlignment so the arrays of a mapped file
+// can be used in place.
+constexpr size_t SnapshotAlignment = 16;
+
+struct SnapshotHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t SectionCount;
+    uint32_t Reserved;
+};
+
+struct SnapshotSectionHeader {
+    uint32_t Count;
+    uint32_t InUse;
+    uint64_t ValueBytes;
+};
+
+static_assert(sizeof(SnapshotHeader) % SnapshotAlignment == 0);
+static_assert(sizeof(SnapshotSectionHeader) % SnapshotAlignment == 0);
+static_assert(sizeof(entt::entity) == sizeof(uint32_t));
+
+inline uint64_t AlignSnapshotSize(uint64_t size) {
+    return (size + SnapshotAlignment - 1) / SnapshotAlignment * SnapshotAlignment;
+}
+
+// Archive for entt::snapshot. entt hands it a pool as a size (plus the
+// number of live entities for the entity pool) followed by entity/component
+// pairs; the pairs are split into an entity array and a value array so
+// every section stores its pool as two flat blocks. Sections are appended
+// to `out` by EndSection().
+class SnapshotOutputArchive {
+public:
+    explicit SnapshotOutputArchive(std::vector<uint8_t> &out)
+        : m_Out(&out) {}
+
+    bool IsValid() const {
+        return m_Ok;
+    }
+
+    void BeginSection() {
+        m_Counts = 0;
+        m_Section = {};
+        m_Entities.clear();
+        m_Values.clear();
+        m_Strings.clear();
+        m_StringIndex.Clear();
+    }
+
+    void EndSection() {
+        if(m_Entities.size() != m_Section.Count) {
+            m_Ok = false;
+            return;
+        }
+
+        if(!m_Strings.empty()) {
+            uint32_t count = static_cast<uint32_t>(m_Strings.size());
+            Append(&count, sizeof(count));
+            for(InternedString string: m_Strings) {
+                uint32_t length = static_cast<uint32_t>(string.Size());
+                Append(&length, sizeof(length));
+                Append(string.CStr(), length);
+            }
+        }
+
+        m_Section.ValueBytes = m_Values.size();
+        Write(&m_Section, sizeof(m_Section));
+        Write(m_Entities.data(), m_Entities.size() * sizeof(entt::entity));
+        Write(m_Values.data(), m_Values.size());
+    }
+
+    void operator()(uint32_t value) {
+        if(m_Counts++ == 0)
+            m_Section.Count = value;
+        else
+            m_Section.InUse = value;
+    }
+
+    void operator()(entt::entity entity) {
+        m_Entities.push_back(entity);
+    }
+
+    // Interned handles only mean something inside one process, so a tag is
+    // stored as a uint32_t index into the section's string table, which
+    // follows the indices: a uint32_t string count, then every string as a
+    // uint32_t length and its bytes. Each distinct name is written once.
+    void operator()(const TagComponent &tag) {
+        uint32_t next = static_cast<uint32_t>(m_Strings.size());
+        uint32_t &index = m_StringIndex[tag.Tag.GetHandle()];
+        if(index == 0) {
+            m_Strings.push_back(tag.Tag);
+            index = next + 1;
+        }
+        uint32_t value = index - 1;
+        Append(&value, sizeof(value));
+    }
+
+    template<typename Type>
+    void operator()(const Type &value) {
+        static_assert(std::is_trivially_copyable_v<Type>, "Component needs an archive overload");
+        Append(&value, sizeof(Type));
+    }
+
+private:
+    void Append(const void *data, size_t size) {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        m_Values.insert(m_Values.end(), bytes, bytes + size);
+    }
+
+    // Appends `size` bytes and the padding that follows them.
+    void Write(const void *data, size_t size) {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        m_Out->insert(m_Out->end(), bytes, bytes + size);
+        m_Out->resize(m_Out->size() + AlignSnapshotSize(size) - size, 0);
+    }
+
+private:
+    std::vector<uint8_t> *m_Out;
+    bool m_Ok = true;
+    uint32_t m_Counts = 0;
+    SnapshotSectionHeader m_Section = {};
+    std::vector<entt::entity> m_Entities;
+    std::vector<uint8_t> m_Values;
+    // The section's string table, and handle -> table index + 1.
+    std::vector<InternedString> m_Strings;
+    FlatHashMap<uint32_t, uint32_t> m_StringIndex;
+};
+
+struct SnapshotSectionView {
+    SnapshotSectionHeader Header;
+    const entt::entity *Entities;
+    const uint8_t *Values;
+};
+
+// Splits `size` bytes at `data` (which must be SnapshotAlignment aligned)
+// into `count` sections, starting `offset` bytes in. Returns false if the
+// sections do not fit.
+inline bool ReadSnapshotSections(const uint8_t *data, uint64_t size, uint64_t offset,
+                                 SnapshotSectionView *sections, uint32_t count) {
+    for(uint32_t i = 0; i < count; i++) {
+        SnapshotSectionView &section = sections[i];
+        if(offset > size || size - offset < sizeof(SnapshotSectionHeader))
+            return false;
+        std::memcpy(&section.Header, data + offset, sizeof(SnapshotSectionHeader));
+        offset += sizeof(SnapshotSectionHeader);
+
+        uint64_t entityBytes = AlignSnapshotSize(uint64_t(section.Header.Count) * sizeof(entt::entity));
+        if(size - offset < entityBytes)
+            return false;
+        section.Entities = reinterpret_cast<const entt::entity *>(data + offset);
+        offset += entityBytes;
+
+        if(section.Header.ValueBytes > size - offset || size - offset < AlignSnapshotSize(section.Header.ValueBytes))
+            return false;
+        section.Values = data + offset;
+        offset += AlignSnapshotSize(section.Header.ValueBytes);
+    }
+    return true;
+}
+
+// Values of a plain-data section, or null if the section does not hold
+// exactly one Type per entity.
+template<typename Type>
+const Type *GetSnapshotValues(const SnapshotSectionView &section) {
+    static_assert(std::is_trivially_copyable_v<Type>);
+    if(section.Header.ValueBytes != uint64_t(section.Header.Count) * sizeof(Type))
+        return nullptr;
+    return reinterpret_cast<const Type *>(section.Values);
+}
+
+// Interns the string table of a TagComponent section into `strings`; the
+// per-entity indices are the section's first Count uint32_t values.
+// Returns false if the table is malformed.
+inline bool ReadSnapshotStrings(const SnapshotSectionView &section, std::vector<InternedString> &strings) {
+    strings.clear();
+    if(section.Header.Count == 0)
+        return true;
+
+    uint64_t offset = uint64_t(section.Header.Count) * sizeof(uint32_t);
+    uint64_t size = section.Header.ValueBytes;
+    uint32_t count;
+    if(size < offset || size - offset < sizeof(count))
+        return false;
+    std::memcpy(&count, section.Values + offset, sizeof(count));
+    offset += sizeof(count);
+    if(count > (size - offset) / sizeof(uint32_t))
+        return false;
+
+    strings.reserve(count);
+    for(uint32_t i = 0; i < count; i++) {
+        uint32_t length;
+        if(size - offset < sizeof(length))
+            return false;
+        std::memcpy(&length, section.Values + offset, sizeof(length));
+        offset += sizeof(length);
+        if(size - offset < length)
+            return false;
+        strings.emplace_back(std::string_view(reinterpret_cast<const char *>(section.Values + offset), length));
+        offset += length;
+    }
+    return offset == size;
+}
+
+// Archive for entt::snapshot_loader and entt::continuous_loader, reading
+// one section in place.
+class SnapshotInputArchive {
+public:
+    explicit SnapshotInputArchive(const SnapshotSectionView &section)
+        : m_Section(section) {}
+
+    bool IsValid() const {
+        return m_Ok;
+    }
+
+    void operator()(uint32_t &value) {
+        value = m_Counts++ == 0 ? m_Section.Header.Count : m_Section.Header.InUse;
+    }
+
+    void operator()(entt::entity &entity) {
+        entity = m_Section.Entities[m_NextEntity++];
+    }
+
+    void operator()(TagComponent &tag) {
+        if(m_Offset == 0 && !ReadSnapshotStrings(m_Section, m_Strings))
+            m_Ok = false;
+
+        uint32_t index;
+        if(!m_Ok || !Read(&index, sizeof(index)) || index >= m_Strings.size()) {
+            m_Ok = false;
+            return;
+        }
+        tag.Tag = m_Strings[index];
+    }
+
+private:
+    bool Read(void *data, size_t size) {
+        if(m_Section.Header.ValueBytes - m_Offset < size)
+            return false;
+        std::memcpy(data, m_Section.Values + m_Offset, size);
+        m_Offset += size;
+        return true;
+    }
+
+private:
+    const SnapshotSectionView &m_Section;
+    bool m_Ok = true;
+    uint32_t m_Counts = 0;
+    size_t m_NextEntity = 0;
+    uint64_t m_Offset = 0;
+    std::vector<InternedString> m_Strings;
+};
+
+} // namespace VPP
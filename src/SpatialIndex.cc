@@ -0,0 +1,495 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <utility>
+#include "ParallelForEach.h"
+
+namespace VPP {
+
+namespace {
+
+// Grid cell coordinates are packed 21 bits per axis into the cell key.
+constexpr int CellBits = 21;
+constexpr int CellOffset = 1 << (CellBits - 1);
+constexpr uint64_t CellMask = (uint64_t(1) << CellBits) - 1;
+
+bool IsCellInRange(const glm::ivec3 &cell) {
+    return cell.x >= -CellOffset && cell.x < CellOffset && cell.y >= -CellOffset && cell.y < CellOffset &&
+           cell.z >= -CellOffset && cell.z < CellOffset;
+}
+
+uint64_t PackCell(const glm::ivec3 &cell) {
+    return (uint64_t(cell.x + CellOffset) << (2 * CellBits)) | (uint64_t(cell.y + CellOffset) << CellBits) |
+           uint64_t(cell.z + CellOffset);
+}
+
+glm::ivec3 UnpackCell(uint64_t key) {
+    return {int((key >> (2 * CellBits)) & CellMask) - CellOffset, int((key >> CellBits) & CellMask) - CellOffset,
+            int(key & CellMask) - CellOffset};
+}
+
+float DistanceSquared(const glm::vec3 &a, const glm::vec3 &b) {
+    glm::vec3 delta = a - b;
+    return glm::dot(delta, delta);
+}
+
+// Squared distance from `point` to the box, 0 inside it.
+float DistanceSquaredToBox(const glm::vec3 &point, const glm::vec3 &min, const glm::vec3 &max) {
+    glm::vec3 delta = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+    return glm::dot(delta, delta);
+}
+
+bool IsInsideBox(const glm::vec3 &point, const glm::vec3 &min, const glm::vec3 &max) {
+    return point.x >= min.x && point.y >= min.y && point.z >= min.z && point.x <= max.x && point.y <= max.y &&
+           point.z <= max.z;
+}
+
+// Per-thread scratch, so queries running in batches do not allocate once
+// the vectors have grown.
+std::vector<std::pair<float, entt::entity>> &GetNearestScratch() {
+    thread_local std::vector<std::pair<float, entt::entity>> s_Nearest;
+    return s_Nearest;
+}
+
+std::vector<uint32_t> &GetNodeStack() {
+    thread_local std::vector<uint32_t> s_Stack;
+    return s_Stack;
+}
+
+std::vector<std::pair<float, uint32_t>> &GetNodeQueue() {
+    thread_local std::vector<std::pair<float, uint32_t>> s_Queue;
+    return s_Queue;
+}
+
+// The `count` closest candidates seen so far, as a max-heap on distance.
+class NearestSet {
+public:
+    NearestSet(size_t count, float maxDistance)
+        : m_Heap(GetNearestScratch()), m_Count(count), m_MaxDistanceSquared(maxDistance * maxDistance) {
+        m_Heap.clear();
+    }
+
+    bool IsFull() const {
+        return m_Heap.size() == m_Count;
+    }
+
+    // Squared distance a candidate has to beat.
+    float GetBound() const {
+        return IsFull() ? m_Heap.front().first : m_MaxDistanceSquared;
+    }
+
+    void Offer(float distanceSquared, entt::entity entity) {
+        if(!IsFull()) {
+            if(distanceSquared > m_MaxDistanceSquared)
+                return;
+            m_Heap.emplace_back(distanceSquared, entity);
+            std::push_heap(m_Heap.begin(), m_Heap.end());
+        } else if(distanceSquared < m_Heap.front().first) {
+            std::pop_heap(m_Heap.begin(), m_Heap.end());
+            m_Heap.back() = {distanceSquared, entity};
+            std::push_heap(m_Heap.begin(), m_Heap.end());
+        }
+    }
+
+    // Writes the candidates to `result`, nearest first.
+    void Finish(std::vector<entt::entity> &result) {
+        std::sort_heap(m_Heap.begin(), m_Heap.end());
+        result.reserve(m_Heap.size());
+        for(const auto &[distanceSquared, entity]: m_Heap)
+            result.push_back(entity);
+    }
+
+private:
+    std::vector<std::pair<float, entt::entity>> &m_Heap;
+    size_t m_Count;
+    float m_MaxDistanceSquared;
+};
+
+} // namespace
+
+void SpatialIndex::QueryRadiusBatch(ThreadPool &pool, const SpatialSphere *queries, size_t count,
+                                    std::vector<entt::entity> *results, size_t grainSize) const {
+    ParallelForEachChunk(pool, queries, count, grainSize, [this, queries, results](const SpatialSphere &query) {
+        QueryRadius(query.Center, query.Radius, results[&query - queries]);
+    });
+}
+
+void SpatialIndex::QueryBoxBatch(ThreadPool &pool, const SpatialBox *queries, size_t count,
+                                 std::vector<entt::entity> *results, size_t grainSize) const {
+    ParallelForEachChunk(pool, queries, count, grainSize, [this, queries, results](const SpatialBox &query) {
+        QueryBox(query.Min, query.Max, results[&query - queries]);
+    });
+}
+
+void SpatialIndex::QueryNearestBatch(ThreadPool &pool, const glm::vec3 *points, size_t count, size_t nearest,
+                                     std::vector<entt::entity> *results, float maxDistance, size_t grainSize) const {
+    ParallelForEachChunk(pool, points, count, grainSize, [this, points, nearest, results, maxDistance](const glm::vec3 &point) {
+        QueryNearest(point, nearest, results[&point - points], maxDistance);
+    });
+}
+
+void SpatialIndex::EraseEntry(std::vector<Entry> &entries, uint32_t index) {
+    uint32_t last = static_cast<uint32_t>(entries.size() - 1);
+    if(index != last) {
+        entries[index] = entries[last];
+        m_Slots.Find(entries[index].Entity)->Index = index;
+    }
+    entries.pop_back();
+}
+
+SpatialGrid::SpatialGrid(const SpatialIndexSettings &settings)
+    : SpatialIndex(settings), m_InverseCellSize(1.0f / settings.CellSize) {
+    assert(settings.CellSize > 0.0f);
+}
+
+glm::ivec3 SpatialGrid::GetCell(const glm::vec3 &position) const {
+    // Clamped before the conversion: far away objects share the edge cells.
+    glm::vec3 cell = glm::clamp(glm::floor(position * m_InverseCellSize), glm::vec3(float(-CellOffset)),
+                                glm::vec3(float(CellOffset - 1)));
+    return glm::ivec3(cell);
+}
+
+template<typename Func>
+void SpatialGrid::ForEachCell(const glm::ivec3 &first, const glm::ivec3 &last, Func &&func) const {
+    double cells = double(last.x - first.x + 1) * double(last.y - first.y + 1) * double(last.z - first.z + 1);
+    if(cells > double(m_Cells.Size())) {
+        m_Cells.ForEach([&](uint64_t key, const std::vector<Entry> &entries) {
+            glm::ivec3 cell = UnpackCell(key);
+            if(glm::all(glm::greaterThanEqual(cell, first)) && glm::all(glm::lessThanEqual(cell, last)))
+                func(entries);
+        });
+        return;
+    }
+
+    for(int x = first.x; x <= last.x; x++) {
+        for(int y = first.y; y <= last.y; y++) {
+            for(int z = first.z; z <= last.z; z++) {
+                if(const std::vector<Entry> *entries = m_Cells.Find(PackCell({x, y, z})))
+                    func(*entries);
+            }
+        }
+    }
+}
+
+void SpatialGrid::Update(entt::entity entity, const glm::vec3 &position) {
+    uint64_t cell = PackCell(GetCell(position));
+    Slot *slot = m_Slots.Find(entity);
+    if(slot) {
+        if(slot->Bucket == cell) {
+            (*m_Cells.Find(cell))[slot->Index].Position = position;
+            return;
+        }
+
+        uint64_t oldCell = slot->Bucket;
+        std::vector<Entry> &oldEntries = *m_Cells.Find(oldCell);
+        EraseEntry(oldEntries, slot->Index);
+        if(oldEntries.empty())
+            m_Cells.Erase(oldCell);
+    }
+
+    std::vector<Entry> &entries = m_Cells[cell];
+    Slot moved{cell, static_cast<uint32_t>(entries.size())};
+    entries.push_back({position, entity});
+    if(slot)
+        *slot = moved;
+    else
+        m_Slots.InsertOrAssign(entity, moved);
+}
+
+void SpatialGrid::Remove(entt::entity entity) {
+    const Slot *slot = m_Slots.Find(entity);
+    if(!slot)
+        return;
+
+    uint64_t cell = slot->Bucket;
+    std::vector<Entry> &entries = *m_Cells.Find(cell);
+    EraseEntry(entries, slot->Index);
+    if(entries.empty())
+        m_Cells.Erase(cell);
+    m_Slots.Erase(entity);
+}
+
+void SpatialGrid::Clear() {
+    m_Cells.Clear();
+    m_Slots.Clear();
+}
+
+void SpatialGrid::QueryRadius(const glm::vec3 &center, float radius, std::vector<entt::entity> &result) const {
+    result.clear();
+    if(radius < 0.0f)
+        return;
+
+    float radiusSquared = radius * radius;
+    ForEachCell(GetCell(center - radius), GetCell(center + radius), [&](const std::vector<Entry> &entries) {
+        for(const Entry &entry: entries) {
+            if(DistanceSquared(entry.Position, center) <= radiusSquared)
+                result.push_back(entry.Entity);
+        }
+    });
+}
+
+void SpatialGrid::QueryBox(const glm::vec3 &min, const glm::vec3 &max, std::vector<entt::entity> &result) const {
+    result.clear();
+    ForEachCell(GetCell(min), GetCell(max), [&](const std::vector<Entry> &entries) {
+        for(const Entry &entry: entries) {
+            if(IsInsideBox(entry.Position, min, max))
+                result.push_back(entry.Entity);
+        }
+    });
+}
+
+void SpatialGrid::QueryNearest(const glm::vec3 &point, size_t count, std::vector<entt::entity> &result,
+                               float maxDistance) const {
+    result.clear();
+    if(count == 0 || maxDistance < 0.0f || m_Cells.IsEmpty())
+        return;
+
+    NearestSet nearest(count, maxDistance);
+    auto offer = [&nearest, &point](const std::vector<Entry> &entries) {
+        for(const Entry &entry: entries)
+            nearest.Offer(DistanceSquared(entry.Position, point), entry.Entity);
+    };
+
+    // Searches shells of cells around the point's cell. Once shells 0..r-1
+    // are done, anything unseen is at least (r - 1) cells away.
+    glm::ivec3 center = GetCell(point);
+    float cellSize = m_Settings.CellSize;
+    size_t probed = 0;
+    for(int ring = 0;; ring++) {
+        float reach = float(ring - 1) * cellSize;
+        if(ring > 0 && reach * reach > nearest.GetBound())
+            break;
+
+        // When probing the shell costs more than walking every occupied
+        // cell, finish with the cells outside the shells already searched.
+        size_t shellCells = ring == 0 ? 1 : size_t(2 * ring + 1) * (2 * ring + 1) * (2 * ring + 1) -
+                                                size_t(2 * ring - 1) * (2 * ring - 1) * (2 * ring - 1);
+        if(ring > 0 && probed + shellCells > m_Cells.Size()) {
+            m_Cells.ForEach([&](uint64_t key, const std::vector<Entry> &entries) {
+                glm::ivec3 offset = glm::abs(UnpackCell(key) - center);
+                if(std::max(offset.x, std::max(offset.y, offset.z)) >= ring)
+                    offer(entries);
+            });
+            break;
+        }
+        probed += shellCells;
+
+        for(int x = -ring; x <= ring; x++) {
+            for(int y = -ring; y <= ring; y++) {
+                // Inside the shell's x/y rim only the two z faces belong to it.
+                bool rim = x == -ring || x == ring || y == -ring || y == ring;
+                int step = rim ? 1 : 2 * ring;
+                for(int z = -ring; z <= ring; z += step) {
+                    glm::ivec3 cell = center + glm::ivec3(x, y, z);
+                    if(!IsCellInRange(cell))
+                        continue;
+                    if(const std::vector<Entry> *entries = m_Cells.Find(PackCell(cell)))
+                        offer(*entries);
+                }
+            }
+        }
+    }
+
+    nearest.Finish(result);
+}
+
+LooseOctree::LooseOctree(const SpatialIndexSettings &settings)
+    : SpatialIndex(settings) {
+    assert(settings.HalfExtent > 0.0f && settings.Looseness >= 1.0f);
+    AddNode(settings.Center, settings.HalfExtent, 0);
+}
+
+uint32_t LooseOctree::AddNode(const glm::vec3 &center, float halfSize, uint32_t depth) {
+    Node node;
+    node.Center = center;
+    node.HalfSize = halfSize;
+    node.LooseMin = center - halfSize * m_Settings.Looseness;
+    node.LooseMax = center + halfSize * m_Settings.Looseness;
+    node.Depth = depth;
+    m_Nodes.push_back(std::move(node));
+    return static_cast<uint32_t>(m_Nodes.size() - 1);
+}
+
+bool LooseOctree::InsideLoose(uint32_t node, const glm::vec3 &position) const {
+    // The root also takes everything outside its bounds.
+    return node == 0 || IsInsideBox(position, m_Nodes[node].LooseMin, m_Nodes[node].LooseMax);
+}
+
+uint32_t LooseOctree::GetChild(uint32_t node, const glm::vec3 &position) const {
+    const glm::vec3 &center = m_Nodes[node].Center;
+    uint32_t octant = (position.x >= center.x ? 1 : 0) | (position.y >= center.y ? 2 : 0) | (position.z >= center.z ? 4 : 0);
+    return m_Nodes[node].FirstChild + octant;
+}
+
+void LooseOctree::Insert(entt::entity entity, const glm::vec3 &position) {
+    uint32_t node = 0;
+    while(m_Nodes[node].FirstChild != 0) {
+        uint32_t child = GetChild(node, position);
+        if(!InsideLoose(child, position))
+            break;
+        node = child;
+    }
+
+    std::vector<Entry> &entries = m_Nodes[node].Entries;
+    m_Slots.InsertOrAssign(entity, Slot{node, static_cast<uint32_t>(entries.size())});
+    entries.push_back({position, entity});
+
+    if(m_Nodes[node].FirstChild == 0 && entries.size() > m_Settings.SplitThreshold &&
+       m_Nodes[node].Depth < m_Settings.MaxDepth)
+        Split(node);
+}
+
+void LooseOctree::Split(uint32_t node) {
+    glm::vec3 center = m_Nodes[node].Center;
+    float half = m_Nodes[node].HalfSize * 0.5f;
+    uint32_t depth = m_Nodes[node].Depth + 1;
+
+    uint32_t firstChild = static_cast<uint32_t>(m_Nodes.size());
+    for(uint32_t i = 0; i < 8; i++) {
+        glm::vec3 offset = {i & 1 ? half : -half, i & 2 ? half : -half, i & 4 ? half : -half};
+        AddNode(center + offset, half, depth);
+    }
+    m_Nodes[node].FirstChild = firstChild;
+
+    // Objects that fit no child's loose bounds (only possible outside the
+    // node's own cube) stay behind.
+    std::vector<Entry> entries = std::move(m_Nodes[node].Entries);
+    m_Nodes[node].Entries.clear();
+    for(const Entry &entry: entries) {
+        uint32_t child = GetChild(node, entry.Position);
+        uint32_t target = InsideLoose(child, entry.Position) ? child : node;
+        std::vector<Entry> &targetEntries = m_Nodes[target].Entries;
+        *m_Slots.Find(entry.Entity) = {target, static_cast<uint32_t>(targetEntries.size())};
+        targetEntries.push_back(entry);
+    }
+
+    for(uint32_t child = firstChild; child < firstChild + 8; child++) {
+        if(m_Nodes[child].Entries.size() > m_Settings.SplitThreshold && depth < m_Settings.MaxDepth)
+            Split(child);
+    }
+}
+
+void LooseOctree::Update(entt::entity entity, const glm::vec3 &position) {
+    if(Slot *slot = m_Slots.Find(entity)) {
+        // Small moves stay inside the leaf's loose bounds and cost a store.
+        uint32_t node = static_cast<uint32_t>(slot->Bucket);
+        if(m_Nodes[node].FirstChild == 0 && InsideLoose(node, position)) {
+            m_Nodes[node].Entries[slot->Index].Position = position;
+            return;
+        }
+        EraseEntry(m_Nodes[node].Entries, slot->Index);
+    }
+    Insert(entity, position);
+}
+
+void LooseOctree::Remove(entt::entity entity) {
+    const Slot *slot = m_Slots.Find(entity);
+    if(!slot)
+        return;
+
+    EraseEntry(m_Nodes[slot->Bucket].Entries, slot->Index);
+    m_Slots.Erase(entity);
+}
+
+void LooseOctree::Clear() {
+    m_Nodes.clear();
+    m_Slots.Clear();
+    AddNode(m_Settings.Center, m_Settings.HalfExtent, 0);
+}
+
+void LooseOctree::QueryRadius(const glm::vec3 &center, float radius, std::vector<entt::entity> &result) const {
+    result.clear();
+    if(radius < 0.0f)
+        return;
+
+    float radiusSquared = radius * radius;
+    std::vector<uint32_t> &stack = GetNodeStack();
+    stack.assign(1, 0);
+    while(!stack.empty()) {
+        const Node &node = m_Nodes[stack.back()];
+        stack.pop_back();
+
+        for(const Entry &entry: node.Entries) {
+            if(DistanceSquared(entry.Position, center) <= radiusSquared)
+                result.push_back(entry.Entity);
+        }
+        if(node.FirstChild == 0)
+            continue;
+        for(uint32_t child = node.FirstChild; child < node.FirstChild + 8; child++) {
+            if(DistanceSquaredToBox(center, m_Nodes[child].LooseMin, m_Nodes[child].LooseMax) <= radiusSquared)
+                stack.push_back(child);
+        }
+    }
+}
+
+void LooseOctree::QueryBox(const glm::vec3 &min, const glm::vec3 &max, std::vector<entt::entity> &result) const {
+    result.clear();
+    std::vector<uint32_t> &stack = GetNodeStack();
+    stack.assign(1, 0);
+    while(!stack.empty()) {
+        const Node &node = m_Nodes[stack.back()];
+        stack.pop_back();
+
+        for(const Entry &entry: node.Entries) {
+            if(IsInsideBox(entry.Position, min, max))
+                result.push_back(entry.Entity);
+        }
+        if(node.FirstChild == 0)
+            continue;
+        for(uint32_t child = node.FirstChild; child < node.FirstChild + 8; child++) {
+            const Node &childNode = m_Nodes[child];
+            if(glm::all(glm::lessThanEqual(min, childNode.LooseMax)) && glm::all(glm::greaterThanEqual(max, childNode.LooseMin)))
+                stack.push_back(child);
+        }
+    }
+}
+
+void LooseOctree::QueryNearest(const glm::vec3 &point, size_t count, std::vector<entt::entity> &result,
+                               float maxDistance) const {
+    result.clear();
+    if(count == 0 || maxDistance < 0.0f || m_Slots.IsEmpty())
+        return;
+
+    // Best-first: nodes come off the queue closest first, so the search
+    // ends at the first node farther away than the current k-th candidate.
+    NearestSet nearest(count, maxDistance);
+    std::vector<std::pair<float, uint32_t>> &queue = GetNodeQueue();
+    auto closer = std::greater<std::pair<float, uint32_t>>();
+    queue.assign(1, {0.0f, 0});
+    while(!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end(), closer);
+        auto [distanceSquared, index] = queue.back();
+        queue.pop_back();
+        if(distanceSquared > nearest.GetBound())
+            break;
+
+        const Node &node = m_Nodes[index];
+        for(const Entry &entry: node.Entries)
+            nearest.Offer(DistanceSquared(entry.Position, point), entry.Entity);
+        if(node.FirstChild == 0)
+            continue;
+        for(uint32_t child = node.FirstChild; child < node.FirstChild + 8; child++) {
+            float childDistance = DistanceSquaredToBox(point, m_Nodes[child].LooseMin, m_Nodes[child].LooseMax);
+            if(childDistance <= nearest.GetBound()) {
+                queue.emplace_back(childDistance, child);
+                std::push_heap(queue.begin(), queue.end(), closer);
+            }
+        }
+    }
+
+    nearest.Finish(result);
+}
+
+std::unique_ptr<SpatialIndex> CreateSpatialIndex(const SpatialIndexSettings &settings) {
+    switch(settings.Type) {
+    case SpatialIndexType::LooseOctree:
+        return std::make_unique<LooseOctree>(settings);
+    case SpatialIndexType::Grid:
+    default:
+        return std::make_unique<SpatialGrid>(settings);
+    }
+}
+
+} // namespace VPP
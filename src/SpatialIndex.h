@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+#include "FlatHashMap.h"
+#include "ThreadPool.h"
+
+namespace VPP {
+
+enum class SpatialIndexType {
+    // Hashed uniform grid: cells of CellSize, only occupied ones stored.
+    // Cheapest to update; best when queries have a typical radius.
+    Grid,
+    // Loose octree over fixed root bounds. Adapts to clustered objects, and
+    // an object only moves between nodes once it leaves its node's loose
+    // bounds.
+    LooseOctree,
+};
+
+struct SpatialIndexSettings {
+    SpatialIndexType Type = SpatialIndexType::Grid;
+
+    // Grid: edge length of a cell, ideally around the common query radius.
+    float CellSize = 16.0f;
+
+    // Octree: the root node's bounds. Objects outside them live in the root
+    // and are tested by every query.
+    glm::vec3 Center = {0.0f, 0.0f, 0.0f};
+    float HalfExtent = 1024.0f;
+    uint32_t MaxDepth = 8;
+    // A leaf splits once it holds more objects than this.
+    uint32_t SplitThreshold = 16;
+    // Node bounds are enlarged by this factor for membership and queries.
+    float Looseness = 2.0f;
+};
+
+struct SpatialSphere {
+    glm::vec3 Center;
+    float Radius;
+};
+
+struct SpatialBox {
+    glm::vec3 Min;
+    glm::vec3 Max;
+};
+
+// Queries a batch hands each task.
+constexpr size_t DefaultSpatialGrainSize = 64;
+
+// Point index over entities, e.g. of their world positions (see
+// Scene::EnableSpatialIndex()). Queries are const and may run from any
+// number of threads at once, as long as nothing modifies the index.
+class SpatialIndex {
+public:
+    explicit SpatialIndex(const SpatialIndexSettings &settings)
+        : m_Settings(settings) {}
+    virtual ~SpatialIndex() = default;
+
+    SpatialIndex(const SpatialIndex &) = delete;
+    SpatialIndex &operator=(const SpatialIndex &) = delete;
+
+    const SpatialIndexSettings &GetSettings() const {
+        return m_Settings;
+    }
+    size_t Size() const {
+        return m_Slots.Size();
+    }
+    bool Contains(entt::entity entity) const {
+        return m_Slots.Contains(entity);
+    }
+
+    // Inserts `entity` at `position`, or moves it there if already present.
+    virtual void Update(entt::entity entity, const glm::vec3 &position) = 0;
+    // Does nothing if `entity` is not in the index.
+    virtual void Remove(entt::entity entity) = 0;
+    virtual void Clear() = 0;
+
+    // Each query replaces the contents of `result`. Radius and box queries
+    // return objects in no particular order, boundaries included.
+    virtual void QueryRadius(const glm::vec3 &center, float radius, std::vector<entt::entity> &result) const = 0;
+    virtual void QueryBox(const glm::vec3 &min, const glm::vec3 &max, std::vector<entt::entity> &result) const = 0;
+    // The `count` objects closest to `point` and no farther than
+    // `maxDistance`, nearest first.
+    virtual void QueryNearest(const glm::vec3 &point, size_t count, std::vector<entt::entity> &result,
+                              float maxDistance = std::numeric_limits<float>::infinity()) const = 0;
+
+    // Runs one query per element on `pool`; results[i] receives the answer
+    // to queries[i].
+    void QueryRadiusBatch(ThreadPool &pool, const SpatialSphere *queries, size_t count,
+                          std::vector<entt::entity> *results, size_t grainSize = DefaultSpatialGrainSize) const;
+    void QueryBoxBatch(ThreadPool &pool, const SpatialBox *queries, size_t count,
+                       std::vector<entt::entity> *results, size_t grainSize = DefaultSpatialGrainSize) const;
+    void QueryNearestBatch(ThreadPool &pool, const glm::vec3 *points, size_t count, size_t nearest,
+                           std::vector<entt::entity> *results,
+                           float maxDistance = std::numeric_limits<float>::infinity(),
+                           size_t grainSize = DefaultSpatialGrainSize) const;
+
+protected:
+    // 16 bytes, so a bucket is a flat array the queries stream through.
+    struct Entry {
+        glm::vec3 Position;
+        entt::entity Entity;
+    };
+
+    // Where an entity's entry lives: a grid cell key or an octree node
+    // index, and the position within that bucket.
+    struct Slot {
+        uint64_t Bucket;
+        uint32_t Index;
+    };
+
+    // Swap-removes entries[index] and repoints the slot of the entry moved
+    // into its place. The removed entity's own slot is left to the caller.
+    void EraseEntry(std::vector<Entry> &entries, uint32_t index);
+
+protected:
+    SpatialIndexSettings m_Settings;
+    FlatHashMap<entt::entity, Slot> m_Slots;
+};
+
+// Hashed uniform grid. Cells are keyed by their packed integer coordinates;
+// a cell is dropped once its last object leaves.
+class SpatialGrid final: public SpatialIndex {
+public:
+    explicit SpatialGrid(const SpatialIndexSettings &settings);
+
+    void Update(entt::entity entity, const glm::vec3 &position) override;
+    void Remove(entt::entity entity) override;
+    void Clear() override;
+
+    void QueryRadius(const glm::vec3 &center, float radius, std::vector<entt::entity> &result) const override;
+    void QueryBox(const glm::vec3 &min, const glm::vec3 &max, std::vector<entt::entity> &result) const override;
+    void QueryNearest(const glm::vec3 &point, size_t count, std::vector<entt::entity> &result,
+                      float maxDistance = std::numeric_limits<float>::infinity()) const override;
+
+private:
+    glm::ivec3 GetCell(const glm::vec3 &position) const;
+
+    // Calls func(entries) for every occupied cell in [first, last]. When
+    // that range spans more cells than are occupied, walks the occupied
+    // cells instead of probing the range.
+    template<typename Func>
+    void ForEachCell(const glm::ivec3 &first, const glm::ivec3 &last, Func &&func) const;
+
+private:
+    float m_InverseCellSize;
+    FlatHashMap<uint64_t, std::vector<Entry>> m_Cells;
+};
+
+// Loose octree. Nodes are split on demand and kept until Clear(); an object
+// sits in the deepest node whose loose bounds contain it.
+class LooseOctree final: public SpatialIndex {
+public:
+    explicit LooseOctree(const SpatialIndexSettings &settings);
+
+    void Update(entt::entity entity, const glm::vec3 &position) override;
+    void Remove(entt::entity entity) override;
+    void Clear() override;
+
+    void QueryRadius(const glm::vec3 &center, float radius, std::vector<entt::entity> &result) const override;
+    void QueryBox(const glm::vec3 &min, const glm::vec3 &max, std::vector<entt::entity> &result) const override;
+    void QueryNearest(const glm::vec3 &point, size_t count, std::vector<entt::entity> &result,
+                      float maxDistance = std::numeric_limits<float>::infinity()) const override;
+
+private:
+    struct Node {
+        glm::vec3 Center;
+        float HalfSize;
+        // Loose bounds: the node's cube scaled by the looseness factor.
+        glm::vec3 LooseMin;
+        glm::vec3 LooseMax;
+        // Index of the first of eight consecutive children; 0 for a leaf
+        // (the root is node 0 and never anyone's child).
+        uint32_t FirstChild = 0;
+        uint32_t Depth = 0;
+        std::vector<Entry> Entries;
+    };
+
+    uint32_t AddNode(const glm::vec3 &center, float halfSize, uint32_t depth);
+    bool InsideLoose(uint32_t node, const glm::vec3 &position) const;
+    uint32_t GetChild(uint32_t node, const glm::vec3 &position) const;
+    void Insert(entt::entity entity, const glm::vec3 &position);
+    void Split(uint32_t node);
+
+private:
+    std::vector<Node> m_Nodes;
+};
+
+std::unique_ptr<SpatialIndex> CreateSpatialIndex(const SpatialIndexSettings &settings);
+
+} // namespace VPP
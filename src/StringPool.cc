@@ -0,0 +1,117 @@
+#include "StringPool.h"
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <new>
+
+namespace VPP {
+
+StringPool::StringPool() {
+    // Handle 0, the empty string.
+    uint32_t empty = Intern(std::string_view());
+    assert(empty == 0);
+    (void)empty;
+}
+
+StringPool &StringPool::Get() {
+    // Never destroyed: components holding handles may outlive static
+    // destruction order.
+    static StringPool *s_Pool = new StringPool();
+    return *s_Pool;
+}
+
+uint32_t StringPool::Intern(std::string_view text) {
+    uint64_t hash = std::hash<std::string_view>{}(text);
+    {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        if(const Record *record = FindLocked(text, hash))
+            return record->Handle;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+    if(const Record *record = FindLocked(text, hash))
+        return record->Handle;
+
+    uint32_t handle = m_Count;
+    size_t page = handle / PageEntries;
+    assert(page < MaxPages && "StringPool is full");
+    if(handle % PageEntries == 0) {
+        m_PageStorage.push_back(std::make_unique<Entry[]>(PageEntries));
+        m_Pages[page].store(m_PageStorage.back().get(), std::memory_order_release);
+    }
+
+    Record *record = Store(text, handle);
+    Entry &entry = m_Pages[page].load(std::memory_order_relaxed)[handle % PageEntries];
+    entry.Data = record->GetData();
+    entry.Size = record->Size;
+
+    const Record *&first = m_Index[hash];
+    record->Next = first;
+    first = record;
+    m_Count++;
+    return handle;
+}
+
+bool StringPool::Find(std::string_view text, uint32_t &handle) const {
+    uint64_t hash = std::hash<std::string_view>{}(text);
+    std::shared_lock<std::shared_mutex> lock(m_Mutex);
+    const Record *record = FindLocked(text, hash);
+    if(!record)
+        return false;
+    handle = record->Handle;
+    return true;
+}
+
+size_t StringPool::GetStringCount() const {
+    std::shared_lock<std::shared_mutex> lock(m_Mutex);
+    return m_Count;
+}
+
+size_t StringPool::GetByteCount() const {
+    std::shared_lock<std::shared_mutex> lock(m_Mutex);
+    return m_Bytes;
+}
+
+const StringPool::Record *StringPool::FindLocked(std::string_view text, uint64_t hash) const {
+    const Record *const *first = m_Index.Find(hash);
+    for(const Record *record = first ? *first : nullptr; record; record = record->Next) {
+        if(std::string_view(record->GetData(), record->Size) == text)
+            return record;
+    }
+    return nullptr;
+}
+
+StringPool::Record *StringPool::Store(std::string_view text, uint32_t handle) {
+    static_assert(sizeof(Record) % alignof(Record) == 0);
+    // Record, text and terminator, rounded up so the next record stays
+    // aligned.
+    size_t bytes = (sizeof(Record) + text.size() + 1 + alignof(Record) - 1) & ~(alignof(Record) - 1);
+    m_Bytes += text.size() + 1;
+
+    char *memory;
+    if(bytes > BlockBytes / 4) {
+        // Long strings get a block of their own rather than wasting the
+        // rest of the current one.
+        m_Blocks.push_back(std::make_unique<char[]>(bytes));
+        memory = m_Blocks.back().get();
+    } else {
+        if(bytes > m_BlockLeft) {
+            m_Blocks.push_back(std::make_unique<char[]>(BlockBytes));
+            m_BlockNext = m_Blocks.back().get();
+            m_BlockLeft = BlockBytes;
+        }
+        memory = m_BlockNext;
+        m_BlockNext += bytes;
+        m_BlockLeft -= bytes;
+    }
+
+    auto *record = new(memory) Record{nullptr, handle, uint32_t(text.size())};
+    char *data = memory + sizeof(Record);
+    if(!text.empty())
+        std::memcpy(data, text.data(), text.size());
+    data[text.size()] = '\0';
+    return record;
+}
+
+} // namespace VPP
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+#include "FlatHashMap.h"
+
+namespace VPP {
+
+// Process-wide table of interned strings. Every distinct string is stored
+// once, in arena blocks that are never freed, and named by a 32-bit handle
+// handed out in insertion order; handle 0 is the empty string. Handles are
+// only meaningful inside the process, so anything written to disk stores
+// the text (see SnapshotOutputArchive).
+//
+// Thread-safe. Interning takes a shared lock for strings already known and
+// an exclusive one to add a string; resolving a handle takes no lock.
+class StringPool {
+public:
+    static constexpr size_t PageEntries = 4096;
+    static constexpr size_t MaxPages = 16384;
+    static constexpr size_t BlockBytes = 64 * 1024;
+
+    static StringPool &Get();
+
+    uint32_t Intern(std::string_view text);
+    // Like Intern(), but never adds: returns false if `text` is unknown.
+    bool Find(std::string_view text, uint32_t &handle) const;
+
+    std::string_view GetString(uint32_t handle) const {
+        const Entry &entry = m_Pages[handle / PageEntries].load(std::memory_order_acquire)[handle % PageEntries];
+        return {entry.Data, entry.Size};
+    }
+
+    size_t GetStringCount() const;
+    // Bytes of text held, terminators included.
+    size_t GetByteCount() const;
+
+private:
+    struct Entry {
+        const char *Data;
+        uint32_t Size;
+    };
+
+    // Stored in the arena right before the text, so a lookup by text finds
+    // the handle and the bytes to compare in the same cache line.
+    struct Record {
+        const Record *Next;
+        uint32_t Handle;
+        uint32_t Size;
+
+        const char *GetData() const {
+            return reinterpret_cast<const char *>(this + 1);
+        }
+    };
+
+    StringPool();
+
+    const Record *FindLocked(std::string_view text, uint64_t hash) const;
+    Record *Store(std::string_view text, uint32_t handle);
+
+private:
+    mutable std::shared_mutex m_Mutex;
+    // Hash -> newest record with that hash; older ones follow Record::Next.
+    FlatHashMap<uint64_t, const Record *> m_Index;
+    std::atomic<Entry *> m_Pages[MaxPages] = {};
+    std::vector<std::unique_ptr<Entry[]>> m_PageStorage;
+    std::vector<std::unique_ptr<char[]>> m_Blocks;
+    char *m_BlockNext = nullptr;
+    size_t m_BlockLeft = 0;
+    uint32_t m_Count = 0;
+    size_t m_Bytes = 0;
+};
+
+// A string from the StringPool. Copying, comparing and hashing compare the
+// 32-bit handle only; the text stays valid for the life of the process.
+class InternedString {
+public:
+    InternedString() = default;
+    explicit InternedString(std::string_view text)
+        : m_Handle(StringPool::Get().Intern(text)) {}
+
+    // Looks up `text` without interning it; false if no string has it.
+    static bool Find(std::string_view text, InternedString &result) {
+        return StringPool::Get().Find(text, result.m_Handle);
+    }
+
+    uint32_t GetHandle() const {
+        return m_Handle;
+    }
+
+    std::string_view View() const {
+        return StringPool::Get().GetString(m_Handle);
+    }
+    // Interned text is always null-terminated.
+    const char *CStr() const {
+        return View().data();
+    }
+    size_t Size() const {
+        return View().size();
+    }
+    bool IsEmpty() const {
+        return m_Handle == 0;
+    }
+
+    operator std::string_view() const {
+        return View();
+    }
+
+    bool operator==(const InternedString &other) const {
+        return m_Handle == other.m_Handle;
+    }
+    bool operator!=(const InternedString &other) const {
+        return m_Handle != other.m_Handle;
+    }
+
+private:
+    uint32_t m_Handle = 0;
+};
+
+} // namespace VPP
@@ -0,0 +1,297 @@
+#include "Texture.h"
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include "ImageOps.h"
+#include "ImageStream.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+
+namespace VPP {
+
+namespace {
+
+// Blob layout: TextureBlobHeader, padding up to TextureBlobAlignment, then
+// the RGBA8 mip chain exactly as Texture keeps it.
+constexpr uint32_t TextureBlobMagic = 0x54505056; // "VPPT"
+constexpr uint32_t TextureBlobVersion = 1;
+constexpr size_t TextureBlobAlignment = 64;
+
+struct TextureBlobHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t Width;
+    uint32_t Height;
+    uint64_t SourceHash;
+    uint64_t SourceSize;
+    int64_t SourceTime;
+    uint64_t PixelBytes;
+};
+
+static_assert(sizeof(TextureBlobHeader) <= TextureBlobAlignment);
+
+struct DecodedImage {
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    PixelBuffer Pixels;
+};
+
+entt::id_type GetTextureID(const std::string &path) {
+    return entt::hashed_string::value(path.c_str(), path.size());
+}
+
+// FNV-1a over 64-bit words, folded after every step so the high bits
+// reach the low ones. Only used to tell whether a source file changed.
+uint64_t HashBytes(const uint8_t *data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+        hash ^= hash >> 32;
+    }
+    for(; i < size; i++)
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    return hash;
+}
+
+std::string GetBlobPath(const std::string &cacheDirectory, const std::string &path) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.vtex",
+                  static_cast<unsigned long long>(HashBytes(reinterpret_cast<const uint8_t *>(path.data()), path.size())));
+    return (std::filesystem::path(cacheDirectory) / name).string();
+}
+
+// Both decoders write level 0 straight into the mip chain allocation.
+std::shared_ptr<uint8_t> AllocateMipChain(const ImageInfo &info) {
+    return std::shared_ptr<uint8_t>(new uint8_t[GetMipChainSize(info.Width, info.Height, 4)], std::default_delete<uint8_t[]>());
+}
+
+void FinishMipChain(const ImageInfo &info, std::shared_ptr<uint8_t> chain, DecodedImage &image) {
+    GenerateMipChainRGBA8(chain.get(), info.Width, info.Height);
+    image.Width = info.Width;
+    image.Height = info.Height;
+    image.Pixels = std::move(chain);
+}
+
+bool DecodeImage(const MappedFile &source, DecodedImage &image) {
+    ImageInfo info;
+    if(!source.IsOpen() || !ReadImageInfo(source.GetData(), source.GetSize(), info))
+        return false;
+
+    std::shared_ptr<uint8_t> chain = AllocateMipChain(info);
+    if(!DecodeImageRGBA8(source.GetData(), source.GetSize(), chain.get(), size_t(info.Width) * info.Height * 4, info))
+        return false;
+
+    FinishMipChain(info, std::move(chain), image);
+    return true;
+}
+
+bool DecodeImage(ImageStream &source, DecodedImage &image) {
+    ImageInfo info;
+    if(!source.ReadInfo(info))
+        return false;
+
+    std::shared_ptr<uint8_t> chain = AllocateMipChain(info);
+    if(!source.DecodeRGBA8(chain.get(), size_t(info.Width) * info.Height * 4, info))
+        return false;
+
+    FinishMipChain(info, std::move(chain), image);
+    return true;
+}
+
+bool ReadBlobHeader(const MappedFile &blob, TextureBlobHeader &header) {
+    if(!blob.IsOpen() || blob.GetSize() < TextureBlobAlignment)
+        return false;
+
+    std::memcpy(&header, blob.GetData(), sizeof(header));
+    return header.Magic == TextureBlobMagic && header.Version == TextureBlobVersion
+           && header.PixelBytes == GetMipChainSize(header.Width, header.Height, 4)
+           && blob.GetSize() - TextureBlobAlignment >= header.PixelBytes;
+}
+
+// The pixels stay in the mapping, which lives as long as they do.
+void UseBlob(std::shared_ptr<MappedFile> blob, const TextureBlobHeader &header, DecodedImage &image) {
+    image.Width = header.Width;
+    image.Height = header.Height;
+    const uint8_t *pixels = blob->GetData() + TextureBlobAlignment;
+    image.Pixels = PixelBuffer(std::move(blob), pixels);
+}
+
+bool WriteBlob(const std::string &blobPath, const TextureBlobHeader &header, const DecodedImage &image) {
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(blobPath).parent_path(), error);
+
+    // Written aside and renamed into place, so a reader never maps half a
+    // blob.
+    std::string tempPath = blobPath + ".tmp";
+    std::FILE *file = std::fopen(tempPath.c_str(), "wb");
+    if(!file)
+        return false;
+
+    uint8_t head[TextureBlobAlignment] = {};
+    std::memcpy(head, &header, sizeof(header));
+    bool ok = std::fwrite(head, sizeof(head), 1, file) == 1
+              && std::fwrite(image.Pixels.get(), 1, header.PixelBytes, file) == header.PixelBytes;
+    ok = std::fclose(file) == 0 && ok;
+
+    if(ok)
+        std::filesystem::rename(tempPath, blobPath, error);
+    if(!ok || error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+// Loads `path` through the blob cache in `cacheDirectory`. `blobValid` is
+// set when an up-to-date blob is on disk afterwards.
+bool LoadCached(const std::string &path, const std::string &cacheDirectory, DecodedImage &image, bool &blobValid) {
+    blobValid = false;
+
+    std::error_code error;
+    uint64_t sourceSize = std::filesystem::file_size(path, error);
+    if(error)
+        return false;
+    int64_t sourceTime = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    if(error)
+        return false;
+
+    std::string blobPath = GetBlobPath(cacheDirectory, path);
+    auto blob = std::make_shared<MappedFile>(blobPath);
+    TextureBlobHeader header;
+    bool hasBlob = ReadBlobHeader(*blob, header);
+    if(hasBlob && header.SourceSize == sourceSize && header.SourceTime == sourceTime) {
+        UseBlob(std::move(blob), header, image);
+        blobValid = true;
+        return true;
+    }
+
+    // Touched but maybe not changed: the content hash decides.
+    MappedFile source(path);
+    if(!source.IsOpen())
+        return false;
+    uint64_t sourceHash = HashBytes(source.GetData(), source.GetSize());
+    if(hasBlob && header.SourceSize == sourceSize && header.SourceHash == sourceHash) {
+        UseBlob(std::move(blob), header, image);
+        blobValid = true;
+        return true;
+    }
+
+    // Stale or missing; the old blob must be unmapped before it is replaced.
+    blob.reset();
+    if(!DecodeImage(source, image))
+        return false;
+
+    header = {TextureBlobMagic, TextureBlobVersion, image.Width, image.Height, sourceHash, sourceSize, sourceTime,
+              GetMipChainSize(image.Width, image.Height, 4)};
+    blobValid = WriteBlob(blobPath, header, image);
+    return true;
+}
+
+} // namespace
+
+uint32_t Texture::GetMipWidth(uint32_t level) const {
+    uint32_t width = m_Width >> level;
+    return width > 0 ? width : 1;
+}
+
+uint32_t Texture::GetMipHeight(uint32_t level) const {
+    uint32_t height = m_Height >> level;
+    return height > 0 ? height : 1;
+}
+
+const uint8_t *Texture::GetMipPixels(uint32_t level) const {
+    assert(level < m_MipCount);
+    return m_Pixels.get() + GetMipOffset(m_Width, m_Height, m_Channels, level);
+}
+
+TextureManager::TextureManager(size_t threadCount)
+    : m_Workers(threadCount > 0 ? threadCount : 1) {
+}
+
+TextureManager::~TextureManager() {
+    m_Workers.Wait(m_Decodes);
+}
+
+TextureHandle TextureManager::Load(const std::string &path) {
+    entt::id_type id = GetTextureID(path);
+    auto [it, loaded] = m_Cache.load(id, path);
+    if(loaded) {
+        m_Workers.Submit(m_Decodes, [this, id, path, cacheDirectory = m_CacheDirectory] {
+            Decode(id, path, cacheDirectory);
+        });
+    }
+    return it->second;
+}
+
+TextureHandle TextureManager::Get(const std::string &path) {
+    return m_Cache[GetTextureID(path)];
+}
+
+bool TextureManager::ImportTexture(const std::string &path, const std::string &cacheDirectory) {
+    DecodedImage image;
+    bool blobValid;
+    return LoadCached(path, cacheDirectory, image, blobValid) && blobValid;
+}
+
+size_t TextureManager::ProcessCompletions(double budgetSeconds) {
+    VPP_PROFILE_FUNCTION();
+    if(m_NextPublish == m_Publishing.size()) {
+        m_Publishing.clear();
+        m_NextPublish = 0;
+        std::lock_guard<std::mutex> lock(m_CompletedMutex);
+        m_Publishing.swap(m_Completed);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t published = 0;
+    while(m_NextPublish < m_Publishing.size()) {
+        Completion &completion = m_Publishing[m_NextPublish++];
+        if(TextureHandle handle = m_Cache[completion.ID]) {
+            Texture &texture = *handle;
+            bool ready = completion.Pixels != nullptr;
+            texture.m_State = ready ? TextureState::Ready : TextureState::Failed;
+            texture.m_Width = completion.Width;
+            texture.m_Height = completion.Height;
+            texture.m_Channels = ready ? 4 : 0;
+            texture.m_MipCount = ready ? GetMipCount(completion.Width, completion.Height) : 0;
+            texture.m_Pixels = std::move(completion.Pixels);
+            if(ready && m_ReadyCallback)
+                m_ReadyCallback(texture);
+        }
+        published++;
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if(elapsed.count() >= budgetSeconds)
+            break;
+    }
+    return published;
+}
+
+void TextureManager::WaitForDecodes() {
+    m_Workers.Wait(m_Decodes);
+}
+
+void TextureManager::Decode(entt::id_type id, const std::string &path, const std::string &cacheDirectory) {
+    VPP_PROFILE_FUNCTION();
+    DecodedImage image;
+    bool blobValid;
+    bool loaded;
+    if(cacheDirectory.empty()) {
+        // Nothing to hash, so the file does not need mapping; stream it.
+        ImageStream source(path);
+        loaded = DecodeImage(source, image);
+    } else {
+        loaded = LoadCached(path, cacheDirectory, image, blobValid);
+    }
+
+    Completion completion = {id, image.Width, image.Height, loaded ? std::move(image.Pixels) : PixelBuffer()};
+    std::lock_guard<std::mutex> lock(m_CompletedMutex);
+    m_Completed.push_back(std::move(completion));
+}
+
+} // namespace VPP
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <entt/entt.hpp>
+#include "ThreadPool.h"
+
+namespace VPP {
+
+// Pixels plus whatever keeps them alive: a heap block for freshly decoded
+// images, or the file mapping of a cached blob.
+using PixelBuffer = std::shared_ptr<const uint8_t>;
+
+enum class TextureState : uint8_t {
+    Loading,
+    Ready,
+    Failed
+};
+
+// RGBA8 image with a full mip chain (see ImageOps.h for the layout), owned
+// by a TextureManager. Stays Loading, without pixels, until the manager's
+// ProcessCompletions() publishes the decoded result.
+class Texture {
+public:
+    explicit Texture(const std::string &path)
+        : m_Path(path) {}
+
+    const std::string &GetPath() const {
+        return m_Path;
+    }
+    TextureState GetState() const {
+        return m_State;
+    }
+    bool IsReady() const {
+        return m_State == TextureState::Ready;
+    }
+
+    uint32_t GetWidth() const {
+        return m_Width;
+    }
+    uint32_t GetHeight() const {
+        return m_Height;
+    }
+    uint32_t GetChannels() const {
+        return m_Channels;
+    }
+    const uint8_t *GetPixels() const {
+        return m_Pixels.get();
+    }
+
+    uint32_t GetMipCount() const {
+        return m_MipCount;
+    }
+    uint32_t GetMipWidth(uint32_t level) const;
+    uint32_t GetMipHeight(uint32_t level) const;
+    const uint8_t *GetMipPixels(uint32_t level) const;
+
+private:
+    std::string m_Path;
+    TextureState m_State = TextureState::Loading;
+    uint32_t m_Width = 0;
+    uint32_t m_Height = 0;
+    uint32_t m_Channels = 0;
+    uint32_t m_MipCount = 0;
+    PixelBuffer m_Pixels;
+
+    friend class TextureManager;
+};
+
+using TextureHandle = entt::resource<Texture>;
+
+// Loads textures without blocking the caller. Load() returns a handle at
+// once and decodes the file with stb_image on the manager's own worker
+// threads (never the scene's pool, where a thread waiting on systems could
+// pick a decode up). Decoded images wait in a completion queue until
+// ProcessCompletions() publishes them, which Scene::OnUpdate() does every
+// frame within its asset time budget.
+//
+// With a cache directory set, every decoded image and its mip chain is also
+// written to a blob there. Later loads map the blob and use its pixels in
+// place, without decoding or copying. A blob is reused while the source
+// file's size and modification time match, or its content hash does when
+// they do not; otherwise the source is imported again, on the workers like
+// any other load.
+//
+// Load() and ProcessCompletions() must be called from one thread.
+class TextureManager {
+public:
+    explicit TextureManager(size_t threadCount = 2);
+    ~TextureManager();
+
+    TextureManager(const TextureManager &) = delete;
+    TextureManager &operator=(const TextureManager &) = delete;
+
+    // Textures are keyed by the hash of their path; loading the same path
+    // again returns the same handle.
+    TextureHandle Load(const std::string &path);
+    TextureHandle Get(const std::string &path);
+
+    // Applies to loads started afterwards. Empty disables the cache.
+    void SetCacheDirectory(const std::string &directory) {
+        m_CacheDirectory = directory;
+    }
+    const std::string &GetCacheDirectory() const {
+        return m_CacheDirectory;
+    }
+
+    // Offline conversion: writes the blob for `path` into `cacheDirectory`
+    // unless an up-to-date one exists. Returns false if the source cannot
+    // be decoded or the blob cannot be written.
+    static bool ImportTexture(const std::string &path, const std::string &cacheDirectory);
+
+    // Runs in ProcessCompletions() for every texture that just became
+    // ready, e.g. to upload it to the GPU.
+    void SetReadyCallback(std::function<void(Texture &)> callback) {
+        m_ReadyCallback = std::move(callback);
+    }
+
+    // Publishes decoded textures until `budgetSeconds` have been spent (at
+    // least one, if any is waiting). Returns how many were published.
+    size_t ProcessCompletions(double budgetSeconds);
+
+    // Blocks until every decode has finished, helping with the work; the
+    // results still have to be published by ProcessCompletions().
+    void WaitForDecodes();
+
+private:
+    struct Completion {
+        entt::id_type ID;
+        uint32_t Width;
+        uint32_t Height;
+        PixelBuffer Pixels;
+    };
+
+    void Decode(entt::id_type id, const std::string &path, const std::string &cacheDirectory);
+
+private:
+    entt::resource_cache<Texture> m_Cache;
+    std::function<void(Texture &)> m_ReadyCallback;
+    std::string m_CacheDirectory;
+
+    ThreadPool m_Workers;
+    TaskGroup m_Decodes;
+
+    std::mutex m_CompletedMutex;
+    std::vector<Completion> m_Completed;
+
+    // Taken off m_Completed but not yet published because a budget ran out.
+    std::vector<Completion> m_Publishing;
+    size_t m_NextPublish = 0;
+};
+
+} // namespace VPP
@@ -0,0 +1,151 @@
+#include "ThreadPool.h"
+#include <string>
+#include "Profiler.h"
+
+namespace VPP {
+
+namespace {
+
+struct WorkerIdentity {
+    const ThreadPool *Pool = nullptr;
+    size_t Index = 0;
+};
+
+thread_local WorkerIdentity s_Worker;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if(threadCount == 0) {
+        size_t hardware = std::thread::hardware_concurrency();
+        threadCount = hardware > 1 ? hardware - 1 : 1;
+    }
+
+    // Threads that are not workers (e.g. the one calling Wait) share the
+    // last queue, which is why there is one more queue than workers.
+    for(size_t i = 0; i <= threadCount; i++)
+        m_Queues.push_back(std::make_unique<Queue>());
+
+    m_Workers.reserve(threadCount);
+    for(size_t i = 0; i < threadCount; i++)
+        m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_Stopping = true;
+    }
+    m_WakeUp.notify_all();
+
+    for(auto &worker: m_Workers)
+        worker.join();
+}
+
+void ThreadPool::Submit(TaskGroup &group, Task task) {
+    group.m_Pending.fetch_add(1, std::memory_order_relaxed);
+
+    Queue &queue = *m_Queues[GetQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.Mutex);
+        queue.PushBack({std::move(task), &group});
+    }
+    m_QueuedTasks.fetch_add(1, std::memory_order_release);
+
+    // Taking the lock orders this notify after a worker's predicate check.
+    { std::lock_guard<std::mutex> lock(m_SleepMutex); }
+    m_WakeUp.notify_one();
+}
+
+void ThreadPool::Wait(TaskGroup &group) {
+    size_t index = GetQueueIndex();
+    while(!group.IsDone()) {
+        if(!TryRunOne(index))
+            std::this_thread::yield();
+    }
+}
+
+ThreadPool &ThreadPool::GetDefault() {
+    static ThreadPool s_Pool;
+    return s_Pool;
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+    s_Worker = {this, index};
+    Profiler::SetThreadName("VPP Worker " + std::to_string(index));
+
+    while(true) {
+        if(TryRunOne(index))
+            continue;
+
+        std::unique_lock<std::mutex> lock(m_SleepMutex);
+        m_WakeUp.wait(lock, [this] {
+            return m_Stopping || m_QueuedTasks.load(std::memory_order_acquire) > 0;
+        });
+        if(m_Stopping && m_QueuedTasks.load(std::memory_order_acquire) == 0)
+            return;
+    }
+}
+
+bool ThreadPool::TryRunOne(size_t index) {
+    QueuedTask task;
+    bool found = false;
+
+    {
+        Queue &own = *m_Queues[index];
+        std::lock_guard<std::mutex> lock(own.Mutex);
+        if(own.Count > 0) {
+            task = own.PopBack();
+            found = true;
+        }
+    }
+
+    for(size_t offset = 1; !found && offset < m_Queues.size(); offset++) {
+        Queue &victim = *m_Queues[(index + offset) % m_Queues.size()];
+        std::lock_guard<std::mutex> lock(victim.Mutex);
+        if(victim.Count > 0) {
+            task = victim.PopFront();
+            found = true;
+        }
+    }
+
+    if(!found)
+        return false;
+
+    m_QueuedTasks.fetch_sub(1, std::memory_order_relaxed);
+    task.Func();
+    task.Group->m_Pending.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+void ThreadPool::Queue::PushBack(QueuedTask task) {
+    if(Count == Tasks.size()) {
+        std::vector<QueuedTask> grown(Tasks.empty() ? 64 : Tasks.size() * 2);
+        for(size_t i = 0; i < Count; i++)
+            grown[i] = std::move(Tasks[(Head + i) % Tasks.size()]);
+        Tasks.swap(grown);
+        Head = 0;
+    }
+    Tasks[(Head + Count) % Tasks.size()] = std::move(task);
+    Count++;
+}
+
+ThreadPool::QueuedTask ThreadPool::Queue::PopBack() {
+    Count--;
+    return std::move(Tasks[(Head + Count) % Tasks.size()]);
+}
+
+ThreadPool::QueuedTask ThreadPool::Queue::PopFront() {
+    QueuedTask task = std::move(Tasks[Head]);
+    Head = (Head + 1) % Tasks.size();
+    Count--;
+    return task;
+}
+
+size_t ThreadPool::GetQueueIndex() {
+    if(s_Worker.Pool == this)
+        return s_Worker.Index;
+    return m_Workers.size();
+}
+
+} // namespace VPP
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VPP {
+
+class ThreadPool;
+
+// Counts the tasks submitted against it that have not finished yet.
+class TaskGroup {
+public:
+    TaskGroup() = default;
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    bool IsDone() const {
+        return m_Pending.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    std::atomic<size_t> m_Pending{0};
+
+    friend class ThreadPool;
+};
+
+// Work-stealing pool: every worker owns a queue, pushes and pops its own
+// tasks at the back and steals from the front of the others when it runs
+// dry. Threads blocked in Wait() run queued tasks instead of sleeping, so
+// tasks may submit and wait on nested groups.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // 0 picks one worker per hardware thread, minus the calling thread.
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t GetThreadCount() const {
+        return m_Workers.size();
+    }
+
+    void Submit(TaskGroup &group, Task task);
+    void Wait(TaskGroup &group);
+
+    // Process-wide pool, created on first use.
+    static ThreadPool &GetDefault();
+
+private:
+    struct QueuedTask {
+        Task Func;
+        TaskGroup *Group = nullptr;
+    };
+
+    // Ring buffer that only ever grows, so once a frame's worth of tasks has
+    // been queued once, later frames queue the same amount without touching
+    // the heap.
+    struct Queue {
+        std::mutex Mutex;
+        std::vector<QueuedTask> Tasks;
+        size_t Head = 0;
+        size_t Count = 0;
+
+        void PushBack(QueuedTask task);
+        QueuedTask PopBack();
+        QueuedTask PopFront();
+    };
+
+    void WorkerLoop(size_t index);
+    bool TryRunOne(size_t index);
+    size_t GetQueueIndex();
+
+private:
+    std::vector<std::unique_ptr<Queue>> m_Queues;
+    std::vector<std::thread> m_Workers;
+    std::atomic<size_t> m_QueuedTasks{0};
+
+    std::mutex m_SleepMutex;
+    std::condition_variable m_WakeUp;
+    bool m_Stopping = false;
+};
+
+} // namespace VPP
@@ -0,0 +1,63 @@
+#include "TransformBatch.h"
+#include "CpuFeatures.h"
+#include "TransformBatchSimd.h"
+
+namespace VPP {
+
+namespace {
+
+using TransformKernel = void (*)(const Transform *, glm::mat4 *, size_t);
+
+struct TransformKernelEntry {
+    TransformKernel Kernel;
+    const char *Name;
+};
+
+#if !defined(VPP_TRANSFORM_LANES_SSE2) && !defined(VPP_TRANSFORM_LANES_NEON)
+void ComputeTransformMatricesScalar(const Transform *transforms, glm::mat4 *out, size_t count) {
+    ComputeTransformMatricesWith<ScalarLanes>(transforms, out, count);
+}
+#endif
+
+#if defined(VPP_TRANSFORM_LANES_SSE2)
+void ComputeTransformMatricesSSE2(const Transform *transforms, glm::mat4 *out, size_t count) {
+    ComputeTransformMatricesWith<SSE2Lanes>(transforms, out, count);
+}
+#endif
+
+#if defined(VPP_TRANSFORM_LANES_NEON)
+void ComputeTransformMatricesNEON(const Transform *transforms, glm::mat4 *out, size_t count) {
+    ComputeTransformMatricesWith<NEONLanes>(transforms, out, count);
+}
+#endif
+
+TransformKernelEntry SelectTransformKernel() {
+#if defined(VPP_HAS_AVX2_KERNEL)
+    if(CpuSupportsAVX2())
+        return {ComputeTransformMatricesAVX2, "avx2"};
+#endif
+#if defined(VPP_TRANSFORM_LANES_SSE2)
+    return {ComputeTransformMatricesSSE2, "sse2"};
+#elif defined(VPP_TRANSFORM_LANES_NEON)
+    return {ComputeTransformMatricesNEON, "neon"};
+#else
+    return {ComputeTransformMatricesScalar, "scalar"};
+#endif
+}
+
+const TransformKernelEntry &GetTransformKernel() {
+    static const TransformKernelEntry s_Kernel = SelectTransformKernel();
+    return s_Kernel;
+}
+
+} // namespace
+
+void ComputeTransformMatrices(const Transform *transforms, glm::mat4 *out, size_t count) {
+    GetTransformKernel().Kernel(transforms, out, count);
+}
+
+const char *GetTransformKernelName() {
+    return GetTransformKernel().Name;
+}
+
+} // namespace VPP
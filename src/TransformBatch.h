@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+namespace VPP {
+
+struct Transform;
+
+// Computes Transform::GetTransform() for `count` transforms into `out`.
+// Transforms are processed 4 or 8 at a time with the widest kernel the CPU
+// supports (AVX2, SSE2 or NEON), picked once at runtime, falling back to a
+// scalar loop elsewhere and for the tail of the range.
+void ComputeTransformMatrices(const Transform *transforms, glm::mat4 *out, size_t count);
+
+// Name of the kernel ComputeTransformMatrices dispatches to.
+const char *GetTransformKernelName();
+
+} // namespace VPP
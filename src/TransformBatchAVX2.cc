@@ -0,0 +1,11 @@
+#include "TransformBatchSimd.h"
+
+namespace VPP {
+
+#if defined(VPP_TRANSFORM_LANES_AVX2)
+void ComputeTransformMatricesAVX2(const Transform *transforms, glm::mat4 *out, size_t count) {
+    ComputeTransformMatricesWith<AVX2Lanes>(transforms, out, count);
+}
+#endif
+
+} // namespace VPP
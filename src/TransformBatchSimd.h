@@ -0,0 +1,281 @@
+#pragma once
+
+// Internal to TransformBatch*.cc. Every translation unit that includes this
+// header gets its own copy of the kernels (anonymous namespace), so units
+// built with different instruction-set flags never share an inline function.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "GameObject.h"
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#include <immintrin.h>
+#define VPP_TRANSFORM_LANES_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VPP_TRANSFORM_LANES_SSE2 1
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define VPP_TRANSFORM_LANES_NEON 1
+#endif
+
+namespace VPP {
+
+// Defined in TransformBatchAVX2.cc, which is built with AVX2/FMA enabled.
+void ComputeTransformMatricesAVX2(const Transform *transforms, glm::mat4 *out, size_t count);
+
+namespace {
+
+struct ScalarLanes {
+    static constexpr size_t Width = 1;
+    using Vec = float;
+    using Int = int32_t;
+    using Mask = bool;
+
+    static Vec Set(float v) { return v; }
+    static Vec Load(const float *p) { return *p; }
+    static Vec Add(Vec a, Vec b) { return a + b; }
+    static Vec Sub(Vec a, Vec b) { return a - b; }
+    static Vec Mul(Vec a, Vec b) { return a * b; }
+    static Vec MulAdd(Vec a, Vec b, Vec c) { return a * b + c; }
+    static Int ToIntRound(Vec v) { return static_cast<Int>(std::nearbyint(v)); }
+    static Vec ToFloat(Int v) { return static_cast<Vec>(v); }
+    static Int AddInt(Int v, int32_t n) { return v + n; }
+    static Mask OddMask(Int q) { return (q & 1) != 0; }
+    static Vec Select(Mask mask, Vec a, Vec b) { return mask ? a : b; }
+    static Vec FlipSign(Vec v, Int q) { return (q & 2) ? -v : v; }
+
+    static void Store(const Vec *m, float *out) {
+        for(size_t i = 0; i < 16; i++) out[i] = m[i];
+    }
+};
+
+#if defined(VPP_TRANSFORM_LANES_SSE2)
+struct SSE2Lanes {
+    static constexpr size_t Width = 4;
+    using Vec = __m128;
+    using Int = __m128i;
+    using Mask = __m128;
+
+    static Vec Set(float v) { return _mm_set1_ps(v); }
+    static Vec Load(const float *p) { return _mm_load_ps(p); }
+    static Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+    static Vec Sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+    static Vec MulAdd(Vec a, Vec b, Vec c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static Int ToIntRound(Vec v) { return _mm_cvtps_epi32(v); }
+    static Vec ToFloat(Int v) { return _mm_cvtepi32_ps(v); }
+    static Int AddInt(Int v, int32_t n) { return _mm_add_epi32(v, _mm_set1_epi32(n)); }
+    static Mask OddMask(Int q) {
+        __m128i one = _mm_set1_epi32(1);
+        return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+    }
+    static Vec Select(Mask mask, Vec a, Vec b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    static Vec FlipSign(Vec v, Int q) {
+        __m128i sign = _mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30);
+        return _mm_xor_ps(v, _mm_castsi128_ps(sign));
+    }
+
+    // m holds element-major registers (m[column * 4 + row], one lane per
+    // transform); transpose them into four column-major matrices.
+    static void Store(const Vec *m, float *out) {
+        for(size_t column = 0; column < 4; column++) {
+            __m128 r0 = m[column * 4 + 0], r1 = m[column * 4 + 1];
+            __m128 r2 = m[column * 4 + 2], r3 = m[column * 4 + 3];
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(out + 0 * 16 + column * 4, r0);
+            _mm_storeu_ps(out + 1 * 16 + column * 4, r1);
+            _mm_storeu_ps(out + 2 * 16 + column * 4, r2);
+            _mm_storeu_ps(out + 3 * 16 + column * 4, r3);
+        }
+    }
+};
+#endif
+
+#if defined(VPP_TRANSFORM_LANES_AVX2)
+struct AVX2Lanes {
+    static constexpr size_t Width = 8;
+    using Vec = __m256;
+    using Int = __m256i;
+    using Mask = __m256;
+
+    static Vec Set(float v) { return _mm256_set1_ps(v); }
+    static Vec Load(const float *p) { return _mm256_load_ps(p); }
+    static Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static Vec Sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+    static Vec MulAdd(Vec a, Vec b, Vec c) { return _mm256_fmadd_ps(a, b, c); }
+    static Int ToIntRound(Vec v) { return _mm256_cvtps_epi32(v); }
+    static Vec ToFloat(Int v) { return _mm256_cvtepi32_ps(v); }
+    static Int AddInt(Int v, int32_t n) { return _mm256_add_epi32(v, _mm256_set1_epi32(n)); }
+    static Mask OddMask(Int q) {
+        __m256i one = _mm256_set1_epi32(1);
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, one), one));
+    }
+    static Vec Select(Mask mask, Vec a, Vec b) { return _mm256_blendv_ps(b, a, mask); }
+    static Vec FlipSign(Vec v, Int q) {
+        __m256i sign = _mm256_slli_epi32(_mm256_and_si256(q, _mm256_set1_epi32(2)), 30);
+        return _mm256_xor_ps(v, _mm256_castsi256_ps(sign));
+    }
+
+    static void Store(const Vec *m, float *out) {
+        for(size_t column = 0; column < 4; column++) {
+            for(size_t half = 0; half < 2; half++) {
+                __m128 r0 = half ? _mm256_extractf128_ps(m[column * 4 + 0], 1) : _mm256_castps256_ps128(m[column * 4 + 0]);
+                __m128 r1 = half ? _mm256_extractf128_ps(m[column * 4 + 1], 1) : _mm256_castps256_ps128(m[column * 4 + 1]);
+                __m128 r2 = half ? _mm256_extractf128_ps(m[column * 4 + 2], 1) : _mm256_castps256_ps128(m[column * 4 + 2]);
+                __m128 r3 = half ? _mm256_extractf128_ps(m[column * 4 + 3], 1) : _mm256_castps256_ps128(m[column * 4 + 3]);
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                float *base = out + half * 4 * 16 + column * 4;
+                _mm_storeu_ps(base + 0 * 16, r0);
+                _mm_storeu_ps(base + 1 * 16, r1);
+                _mm_storeu_ps(base + 2 * 16, r2);
+                _mm_storeu_ps(base + 3 * 16, r3);
+            }
+        }
+    }
+};
+#endif
+
+#if defined(VPP_TRANSFORM_LANES_NEON)
+struct NEONLanes {
+    static constexpr size_t Width = 4;
+    using Vec = float32x4_t;
+    using Int = int32x4_t;
+    using Mask = uint32x4_t;
+
+    static Vec Set(float v) { return vdupq_n_f32(v); }
+    static Vec Load(const float *p) { return vld1q_f32(p); }
+    static Vec Add(Vec a, Vec b) { return vaddq_f32(a, b); }
+    static Vec Sub(Vec a, Vec b) { return vsubq_f32(a, b); }
+    static Vec Mul(Vec a, Vec b) { return vmulq_f32(a, b); }
+    static Vec MulAdd(Vec a, Vec b, Vec c) { return vfmaq_f32(c, a, b); }
+    static Int ToIntRound(Vec v) { return vcvtnq_s32_f32(v); }
+    static Vec ToFloat(Int v) { return vcvtq_f32_s32(v); }
+    static Int AddInt(Int v, int32_t n) { return vaddq_s32(v, vdupq_n_s32(n)); }
+    static Mask OddMask(Int q) {
+        int32x4_t one = vdupq_n_s32(1);
+        return vceqq_s32(vandq_s32(q, one), one);
+    }
+    static Vec Select(Mask mask, Vec a, Vec b) { return vbslq_f32(mask, a, b); }
+    static Vec FlipSign(Vec v, Int q) {
+        uint32x4_t sign = vreinterpretq_u32_s32(vshlq_n_s32(vandq_s32(q, vdupq_n_s32(2)), 30));
+        return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(v), sign));
+    }
+
+    static void Store(const Vec *m, float *out) {
+        for(size_t column = 0; column < 4; column++) {
+            float32x4x2_t t01 = vtrnq_f32(m[column * 4 + 0], m[column * 4 + 1]);
+            float32x4x2_t t23 = vtrnq_f32(m[column * 4 + 2], m[column * 4 + 3]);
+            vst1q_f32(out + 0 * 16 + column * 4, vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])));
+            vst1q_f32(out + 1 * 16 + column * 4, vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])));
+            vst1q_f32(out + 2 * 16 + column * 4, vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+            vst1q_f32(out + 3 * 16 + column * 4, vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])));
+        }
+    }
+};
+#endif
+
+// sin/cos with Cody-Waite reduction to [-pi/4, pi/4] and Cephes minimax
+// polynomials; accurate to a few ulp for the angles transforms use.
+template<typename L>
+inline void SinCos(typename L::Vec x, typename L::Vec &sinOut, typename L::Vec &cosOut) {
+    using Vec = typename L::Vec;
+
+    auto q = L::ToIntRound(L::Mul(x, L::Set(0.636619772f)));
+    Vec qf = L::ToFloat(q);
+    Vec r = L::MulAdd(qf, L::Set(-1.5703125f), x);
+    r = L::MulAdd(qf, L::Set(-4.837512969970703125e-4f), r);
+    r = L::MulAdd(qf, L::Set(-7.549789948768648e-8f), r);
+    Vec r2 = L::Mul(r, r);
+
+    Vec sp = L::MulAdd(L::MulAdd(L::Set(-1.9515295891e-4f), r2, L::Set(8.3321608736e-3f)), r2, L::Set(-1.6666654611e-1f));
+    Vec sinR = L::MulAdd(L::Mul(sp, r2), r, r);
+    Vec cp = L::MulAdd(L::MulAdd(L::Set(2.443315711809948e-5f), r2, L::Set(-1.388731625493765e-3f)), r2, L::Set(4.166664568298827e-2f));
+    Vec cosR = L::MulAdd(cp, L::Mul(r2, r2), L::MulAdd(L::Set(-0.5f), r2, L::Set(1.0f)));
+
+    auto swap = L::OddMask(q);
+    sinOut = L::FlipSign(L::Select(swap, cosR, sinR), q);
+    cosOut = L::FlipSign(L::Select(swap, sinR, cosR), L::AddInt(q, 1));
+}
+
+// Same math as Transform::GetTransform(): T * toMat4(quat(euler)) * S,
+// expanded so the translation and scale are applied without matrix products.
+template<typename L>
+inline void ComputeLanes(const Transform *in, float *out) {
+    using Vec = typename L::Vec;
+
+    alignas(32) float soa[9][L::Width];
+    for(size_t lane = 0; lane < L::Width; lane++) {
+        const Transform &t = in[lane];
+        soa[0][lane] = t.Translation.x;
+        soa[1][lane] = t.Translation.y;
+        soa[2][lane] = t.Translation.z;
+        soa[3][lane] = t.Rotation.x;
+        soa[4][lane] = t.Rotation.y;
+        soa[5][lane] = t.Rotation.z;
+        soa[6][lane] = t.Scale.x;
+        soa[7][lane] = t.Scale.y;
+        soa[8][lane] = t.Scale.z;
+    }
+
+    Vec half = L::Set(0.5f);
+    Vec sx, cx, sy, cy, sz, cz;
+    SinCos<L>(L::Mul(L::Load(soa[3]), half), sx, cx);
+    SinCos<L>(L::Mul(L::Load(soa[4]), half), sy, cy);
+    SinCos<L>(L::Mul(L::Load(soa[5]), half), sz, cz);
+
+    Vec cycz = L::Mul(cy, cz), sysz = L::Mul(sy, sz);
+    Vec sycz = L::Mul(sy, cz), cysz = L::Mul(cy, sz);
+    Vec qw = L::MulAdd(cx, cycz, L::Mul(sx, sysz));
+    Vec qx = L::Sub(L::Mul(sx, cycz), L::Mul(cx, sysz));
+    Vec qy = L::MulAdd(cx, sycz, L::Mul(sx, cysz));
+    Vec qz = L::Sub(L::Mul(cx, cysz), L::Mul(sx, sycz));
+
+    Vec two = L::Set(2.0f), one = L::Set(1.0f), zero = L::Set(0.0f);
+    Vec xx = L::Mul(qx, qx), yy = L::Mul(qy, qy), zz = L::Mul(qz, qz);
+    Vec xy = L::Mul(qx, qy), xz = L::Mul(qx, qz), yz = L::Mul(qy, qz);
+    Vec wx = L::Mul(qw, qx), wy = L::Mul(qw, qy), wz = L::Mul(qw, qz);
+
+    Vec scaleX = L::Load(soa[6]), scaleY = L::Load(soa[7]), scaleZ = L::Load(soa[8]);
+
+    Vec m[16];
+    m[0] = L::Mul(L::Sub(one, L::Mul(two, L::Add(yy, zz))), scaleX);
+    m[1] = L::Mul(L::Mul(two, L::Add(xy, wz)), scaleX);
+    m[2] = L::Mul(L::Mul(two, L::Sub(xz, wy)), scaleX);
+    m[3] = zero;
+    m[4] = L::Mul(L::Mul(two, L::Sub(xy, wz)), scaleY);
+    m[5] = L::Mul(L::Sub(one, L::Mul(two, L::Add(xx, zz))), scaleY);
+    m[6] = L::Mul(L::Mul(two, L::Add(yz, wx)), scaleY);
+    m[7] = zero;
+    m[8] = L::Mul(L::Mul(two, L::Add(xz, wy)), scaleZ);
+    m[9] = L::Mul(L::Mul(two, L::Sub(yz, wx)), scaleZ);
+    m[10] = L::Mul(L::Sub(one, L::Mul(two, L::Add(xx, yy))), scaleZ);
+    m[11] = zero;
+    m[12] = L::Load(soa[0]);
+    m[13] = L::Load(soa[1]);
+    m[14] = L::Load(soa[2]);
+    m[15] = one;
+
+    L::Store(m, out);
+}
+
+// Only reads Transform fields and writes through raw float pointers, so no
+// glm or entt inline function gets emitted with wider ISA flags.
+template<typename L>
+inline void ComputeTransformMatricesWith(const Transform *transforms, glm::mat4 *out, size_t count) {
+    size_t i = 0;
+    for(; i + L::Width <= count; i += L::Width)
+        ComputeLanes<L>(transforms + i, reinterpret_cast<float *>(out + i));
+    for(; i < count; i++)
+        ComputeLanes<ScalarLanes>(transforms + i, reinterpret_cast<float *>(out + i));
+}
+
+} // namespace
+
+} // namespace VPP
@@ -1,14 +1,46 @@
 #include "UUID.h"
+#include <chrono>
 #include <random>
 
 namespace VPP {
 
-UUID GenerateUUID() {
+namespace {
+
+constexpr uint64_t s_BlockSize = 4096;
+
+UUIDGenerator &GetGlobalGenerator() {
     static UUIDGenerator s_Generator;
-    static std::random_device s_RandomDevice;
-    static std::mt19937 s_Engine(s_RandomDevice());
-    static std::uniform_int_distribution<uint16_t> s_UniformDistribution;
-    return s_Generator.Generate(s_UniformDistribution(s_Engine));
+    return s_Generator;
+}
+
+struct UUIDBlock {
+    UUID Next = 0;
+    UUID End = 0;
+};
+
+} // namespace
+
+UUIDGenerator::UUIDGenerator() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    uint64_t millis = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+
+    std::random_device randomDevice;
+    std::uniform_int_distribution<uint64_t> distribution(0, (uint64_t(1) << SequenceBits) - 1);
+
+    m_Next.store((millis << SequenceBits) + distribution(randomDevice), std::memory_order_relaxed);
+}
+
+UUID GenerateUUID() {
+    thread_local UUIDBlock s_Block;
+    if(s_Block.Next == s_Block.End) {
+        s_Block.Next = GetGlobalGenerator().Reserve(s_BlockSize);
+        s_Block.End = s_Block.Next + s_BlockSize;
+    }
+    return s_Block.Next++;
+}
+
+UUID ReserveUUIDs(uint64_t count) {
+    return GetGlobalGenerator().Reserve(count);
 }
 
-} // namespace VPP
\ No newline at end of file
+} // namespace VPP
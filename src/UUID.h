@@ -1,34 +1,45 @@
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <cstdint>
-#include <ctime>
 
 namespace VPP {
 
 typedef uint64_t UUID;
 
+// Hands out ids from a single 64-bit atomic counter. The counter is seeded
+// from the wall clock (milliseconds << SequenceBits) so ids stay ordered
+// across runs, and every id inside a process is unique without locking.
 class UUIDGenerator {
 public:
-    UUIDGenerator() {}
+    static constexpr uint32_t SequenceBits = 20;
+
+    UUIDGenerator();
     ~UUIDGenerator() = default;
 
-    UUID Generate(uint16_t magicNumber) {
-        uint64_t nowTime = time(nullptr);
-        if(m_CurTime != nowTime) {
-            m_CurTime = nowTime;
-            m_Counter = 0;
-        } else {
-            m_Counter++;
-        }
-        return m_CurTime << 32 | (magicNumber << 16 | m_Counter);
+    UUIDGenerator(const UUIDGenerator &) = delete;
+    UUIDGenerator &operator=(const UUIDGenerator &) = delete;
+
+    UUID Generate() {
+        return m_Next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Reserves `count` consecutive ids and returns the first one.
+    UUID Reserve(uint64_t count) {
+        assert(count > 0);
+        return m_Next.fetch_add(count, std::memory_order_relaxed);
     }
 
 private:
-    uint64_t m_CurTime = 0;
-    uint16_t m_Counter = 0;
+    std::atomic<uint64_t> m_Next;
 };
 
+// Thread-safe. Each thread draws ids from a private block reserved with a
+// single fetch_add on the global generator.
 UUID GenerateUUID();
 
-} // namespace VPP
\ No newline at end of file
+// Thread-safe. Reserves `count` consecutive ids and returns the first one.
+UUID ReserveUUIDs(uint64_t count);
+
+} // namespace VPP
@@ -39678,6 +39678,8 @@ template<typename Registry>
 class basic_continuous_loader {
     static_assert(!std::is_const_v<Registry>, "Non-const registry type required");
     using traits_type = typename Registry::traits_type;
+    using alloc_traits = std::allocator_traits<typename Registry::allocator_type>;
+    using remloc_type = dense_map<typename traits_type::entity_type, std::pair<typename Registry::entity_type, typename Registry::entity_type>, std::hash<typename traits_type::entity_type>, std::equal_to<typename traits_type::entity_type>, typename alloc_traits::template rebind_alloc<std::pair<const typename traits_type::entity_type, std::pair<typename Registry::entity_type, typename Registry::entity_type>>>>;
 
     void restore(typename Registry::entity_type entt) {
         if(const auto entity = to_entity(entt); remloc.contains(entity) && remloc[entity].first == entt) {
@@ -39933,7 +39935,7 @@ public:
     }
 
 private:
-    dense_map<typename traits_type::entity_type, std::pair<entity_type, entity_type>> remloc;
+    remloc_type remloc;
     registry_type *reg;
 };
 
@@ -1,4 +1,10 @@
-#include "hzpch.h"
+#include "ImageAllocator.h"
+
+// Route stb_image's allocations through VPP so decodes can land in a
+// caller's buffer (see ImageOutputScope).
+#define STBI_MALLOC(size) VPP::ImageMalloc(size)
+#define STBI_REALLOC(pointer, size) VPP::ImageRealloc(pointer, size)
+#define STBI_FREE(pointer) VPP::ImageFree(pointer)
 
 #define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
\ No newline at end of file
+#include "stb_image.h"